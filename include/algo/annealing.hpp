@@ -2,79 +2,169 @@
 #define ANNEALING_HPP
 
 #include <cmath>
+#include <functional>
+#include <limits>
 
+#include "algo/random.hpp"
+#include "checkpoint.hpp"
 #include "dnn/group.hpp"
 
 namespace Algorithm {
-class IState {
+class IAnnealingState {
  public:
-  virtual ~IState() {}
+  virtual ~IAnnealingState() {}
 
   // Calculate the energy (objective function value) for a given solution
   virtual int evaluate() const = 0;
 
   // Generate a neighboring solution for a given current solution
-  virtual std::shared_ptr<IState> getNeighbor() const = 0;
+  virtual std::shared_ptr<IAnnealingState> getNeighbor(Random& rng) const = 0;
 
   // Print the current state
   virtual void print() const = 0;
+
+  // Encode the state into a checkpoint
+  virtual void save(BinaryWriter& writer) const = 0;
 };
 
 class SimulatedAnnealing {
  public:
-  SimulatedAnnealing(std::shared_ptr<IState> state, double initial_temperature,
-                     double min_temperature, double cooling_rate)
+  SimulatedAnnealing(std::shared_ptr<IAnnealingState> state,
+                     double initial_temperature, double min_temperature,
+                     double cooling_rate, uint64_t seed = 0)
       : state(state),
         initial_temperature(initial_temperature),
         min_temperature(min_temperature),
-        cooling_rate(cooling_rate) {
-    srand(time(0));
+        cooling_rate(cooling_rate),
+        rng(seed) {}
+
+  // Submit a snapshot to the checkpointer every `interval` steps
+  void setCheckpointer(const std::shared_ptr<Checkpointer> _checkpointer,
+                       int interval = 1) {
+    checkpointer = _checkpointer;
+    checkpointInterval = std::max(1, interval);
+  }
+
+  // Encode the temperature, current and best state and random stream
+  void save(BinaryWriter& writer) const {
+    writer.write(step_num);
+    writer.write(temperature);
+    writer.write(current_energy);
+    writer.write(rng.getState());
+    current_solution->save(writer);
+    writer.write(best_energy);
+    best_solution->save(writer);
+  }
+
+  // Restore an annealing saved by save(); run() then continues from it
+  bool restore(BinaryReader& reader,
+               const std::function<std::shared_ptr<IAnnealingState>(
+                   BinaryReader&)>& loadState) {
+    step_num = reader.read<long long>();
+    temperature = reader.read<double>();
+    current_energy = reader.read<int>();
+    rng.setState(reader.read<std::array<uint64_t, 4>>());
+    current_solution = loadState(reader);
+    best_energy = reader.read<int>();
+    best_solution = loadState(reader);
+    return reader.isGood() && current_solution && best_solution;
   }
 
   // Run the simulated annealing algorithm
-  void run() const noexcept {
-    // Initialize the solution with a random value in the range [-1, 1]
-    auto current_solution = state;
-    int current_energy = state->evaluate();
-    double temperature = initial_temperature;
-
-    // Main loop for the simulated annealing process
-    while (temperature >= min_temperature) {
-      // Generate a neighboring solution
-      auto new_solution = state->getNeighbor();
-      int new_energy = state->evaluate();
-
-      // Decide whether to accept the new solution based on its energy and
-      // temperature
-      if (acceptSolution(current_energy, new_energy)) {
-        current_solution = new_solution;
-        current_energy = new_energy;
+  void run() noexcept {
+    while (step()) {
+    }
+
+    current_solution->print();
+  }
+
+  // Take one annealing step, starting from the initial state on the first;
+  // false once the temperature has fallen below the minimum
+  bool step() noexcept {
+    // Start from the initial state unless a checkpoint was restored
+    if (!current_solution) {
+      current_solution = state;
+      current_energy = state->evaluate();
+      temperature = initial_temperature;
+    }
+    if (!best_solution || current_energy < best_energy) {
+      best_solution = current_solution;
+      best_energy = current_energy;
+    }
+
+    if (temperature < min_temperature) return false;
+
+    // Generate a neighboring solution of the current one
+    auto new_solution = current_solution->getNeighbor(rng);
+    int new_energy = new_solution->evaluate();
+
+    // Decide whether to accept the new solution based on its energy and
+    // temperature
+    if (acceptSolution(current_energy, new_energy)) {
+      current_solution = new_solution;
+      current_energy = new_energy;
+      if (verbose)
         printf("Temperature: %f, Energy: %d\n", temperature, current_energy);
-      }
+    }
+    if (current_energy < best_energy) {
+      best_solution = current_solution;
+      best_energy = current_energy;
+    }
 
-      // Decrease the temperature for the next iteration
-      temperature *= cooling_rate;
+    // Decrease the temperature for the next iteration
+    temperature *= cooling_rate;
+
+    step_num++;
+    if (checkpointer && step_num % checkpointInterval == 0) {
+      BinaryWriter writer;
+      save(writer);
+      checkpointer->submit(writer.getBuffer());
     }
+    return temperature >= min_temperature;
+  }
 
-    current_solution->print();
+  // Move to a solution found elsewhere if it has a lower energy
+  void adopt(const std::shared_ptr<IAnnealingState> solution, int energy) {
+    if (current_solution && energy >= current_energy) return;
+
+    if (!current_solution) temperature = initial_temperature;
+    current_solution = solution;
+    current_energy = energy;
+    if (!best_solution || energy < best_energy) {
+      best_solution = solution;
+      best_energy = energy;
+    }
   }
 
+  // Set the current temperature, e.g. to follow a schedule kept elsewhere
+  void setTemperature(double _temperature) noexcept {
+    temperature = _temperature;
+  }
+
+  // Print every accepted solution
+  void setVerbose(bool _verbose) noexcept { verbose = _verbose; }
+
+  // Get the lowest-energy solution seen so far
+  auto getBestState() const noexcept { return best_solution; }
+
+  // Get the energy of the best solution
+  auto getBestEnergy() const noexcept { return best_energy; }
+
  private:
   // Decide whether to accept the new solution based on its energy and
   // temperature
-  bool acceptSolution(double current_energy, double new_energy) const noexcept {
+  bool acceptSolution(double current_energy, double new_energy) noexcept {
     if (new_energy < current_energy) {
       return true;  // Accept the new solution if it's better
     }
     // If the new solution is worse, accept it with a probability based on the
     // temperature
-    double acceptance_prob =
-        exp((current_energy - new_energy) / initial_temperature);
-    return ((rand() % 1000) / 1000.0) < acceptance_prob;
+    double acceptance_prob = exp((current_energy - new_energy) / temperature);
+    return rng.uniformReal() < acceptance_prob;
   }
 
   // Pointer to the external state implementation
-  std::shared_ptr<IState> state;
+  std::shared_ptr<IAnnealingState> state;
 
   // Initial temperature for the simulated annealing process
   double initial_temperature;
@@ -84,6 +174,32 @@ class SimulatedAnnealing {
 
   // Rate at which the temperature decreases
   double cooling_rate;
+
+  // Random stream of the search
+  Random rng;
+
+  // Current solution and its energy
+  std::shared_ptr<IAnnealingState> current_solution;
+  int current_energy = 0;
+
+  // Current temperature
+  double temperature = 0.0;
+
+  // Lowest-energy solution seen and its energy
+  std::shared_ptr<IAnnealingState> best_solution;
+  int best_energy = std::numeric_limits<int>::max();
+
+  // Number of annealing steps taken
+  long long step_num = 0;
+
+  // Whether accepted solutions are printed
+  bool verbose = true;
+
+  // Writer of periodic snapshots
+  std::shared_ptr<Checkpointer> checkpointer;
+
+  // Steps between snapshots
+  int checkpointInterval = 1;
 };
 }  // namespace Algorithm
 
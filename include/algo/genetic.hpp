@@ -2,117 +2,270 @@
 #define GENETIC_HPP
 
 #include <algorithm>
+#include <functional>
+#include <limits>
 
+#include "algo/random.hpp"
+#include "algo/statistics.hpp"
+#include "algo/surrogate.hpp"
+#include "checkpoint.hpp"
 #include "dnn/group.hpp"
-
-/*
-TODO: Add constraint handling mechanisms to the GeneticAlgorithm framework.
-Several typical approaches include:
-
-────────────────────────────────────────────────────────
-1. Implicit Constraint Handling via Encoding
-   - Design the chromosome representation such that all individuals are
-guaranteed to be feasible;
-   - Common in continuous domain problems with bounded variables (e.g., x ∈
-[lower_bound, upper_bound]);
-   - The encoding-to-solution mapping function must always return feasible
-values;
-   - After mutation or crossover, decoded results must remain valid.
-
-────────────────────────────────────────────────────────
-2. Constraint-Preserving Crossover/Mutation Operators
-   - Design custom operators that inherently maintain feasibility after
-application;
-   - Common in permutation-based problems (e.g., TSP), using operators like
-Order Crossover (OX), Partially Mapped Crossover (PMX), etc.;
-   - Mutation can be designed as swapping two indices to preserve valid
-permutations.
-
-────────────────────────────────────────────────────────
-3. Penalty Function Method
-   - Do not restrict the generation of infeasible individuals, but penalize them
-in the fitness function;
-   - Ideal for problems with complex or multi-condition constraints;
-   - Example: fitness = objective - λ × constraint_violation;
-   - λ (penalty coefficient) must be tuned carefully:
-     - Too large → algorithm may prematurely converge to feasible local optima;
-     - Too small → algorithm may explore infeasible regions too much.
-
-────────────────────────────────────────────────────────
-4. Repair After Crossover/Mutation
-   - After applying genetic operators, check if the individual is feasible;
-   - If not, apply repair strategies (e.g., projection back, clipping to bounds,
-or reinitialization);
-   - Useful for moderately sized problems.
-
-────────────────────────────────────────────────────────
-
-Suggested Implementation Steps:
-   - [ ] Support bounds or constraint information in individual encoding.
-   - [ ] Add constraint-checking logic inside mutation/crossover functions.
-   - [ ] Optionally implement either repair-based or penalty-based strategies
-(using a strategy pattern or config enum).
-   - [ ] Add a boolean flag like `enable_constraint_check`.
-   - [ ] Track feasible solution ratio per generation as a debug/diagnostic
-metric.
-*/
+#include "runtime/scheduler.hpp"
 
 namespace Algorithm {
+// How the search treats individuals that violate their constraints
+enum class ConstraintHandling {
+  // Score infeasible individuals as the worst possible cost
+  Reject,
+
+  // Decode every genotype to a feasible solution, leaving the genes as
+  // they are
+  Encoding,
+
+  // Make individuals feasible in place after crossover and mutation
+  Repair,
+
+  // Scale the cost by 1 + penalty * violation, so infeasible individuals
+  // are ranked rather than discarded
+  Penalty,
+};
+
 class IIndividual {
  public:
   virtual ~IIndividual() = default;
 
+  // Cost of the solution, ignoring its constraints
   virtual int fitness() const = 0;
 
-  virtual void mutate() = 0;
+  // Relative amount by which the solution violates its constraints, 0 when
+  // it is feasible
+  virtual double violation() const { return 0.0; }
+
+  // Make the individual feasible in place, as far as possible
+  virtual void repair() {}
+
+  // Get the feasible solution the individual's genes decode to
+  virtual std::shared_ptr<IIndividual> decode() const { return clone(); }
+
+  virtual void mutate(Random& rng) = 0;
 
   virtual void print() const = 0;
 
   virtual std::shared_ptr<IIndividual> clone() const = 0;
 
   virtual std::shared_ptr<IIndividual> crossover(
-      const std::shared_ptr<IIndividual>& other) const = 0;
+      const std::shared_ptr<IIndividual>& other, Random& rng) const = 0;
+
+  // Numeric description of the encoding for the surrogate model
+  virtual std::vector<double> features() const { return {}; }
+
+  // Encode the individual into a checkpoint
+  virtual void save(BinaryWriter& writer) const = 0;
+
+  // Decode the individual from a checkpoint
+  virtual void load(BinaryReader& reader) = 0;
 };
 
 class GeneticAlgorithm {
  public:
   GeneticAlgorithm(int population_size, int generations, float mutation_rate,
-                   float crossover_rate)
+                   float crossover_rate, uint64_t seed = 0)
       : population_size(population_size),
         generations(generations),
         mutation_rate(mutation_rate),
-        crossover_rate(crossover_rate) {
-    srand(time(0));
+        crossover_rate(crossover_rate),
+        rng(seed) {}
+
+  // Prescreen every generation with the surrogate model and evaluate only
+  // the given top fraction exactly (0 disables the surrogate)
+  void enableSurrogate(double _topFraction) noexcept {
+    topFraction = _topFraction;
+  }
+
+  // Evaluate the population through the scheduler
+  void setScheduler(const std::shared_ptr<Runtime::Scheduler> _scheduler) {
+    scheduler = _scheduler;
+  }
+
+  // Stop between generations once the token is cancelled
+  void setCancellationToken(
+      const std::shared_ptr<Runtime::CancellationToken> _token) {
+    token = _token;
+  }
+
+  // Choose how infeasible individuals are handled, with the penalty factor
+  // of ConstraintHandling::Penalty
+  void setConstraintHandling(ConstraintHandling _handling,
+                             double _penalty = 1.0) noexcept {
+    handling = _handling;
+    penalty = _penalty;
+  }
+
+  // Refine the `elites` cheapest feasible individuals of every generation
+  // in place with `refine`, which gets an individual and its cost and
+  // returns the cost after refinement, never higher
+  void setLocalSearch(
+      const std::function<int(IIndividual&, int)> _refine, int _elites) {
+    refine = _refine;
+    elites = _elites;
+  }
+
+  // Print the best individual after every generation; off by default, as
+  // groups are mapped concurrently
+  void setVerbose(bool _verbose) noexcept { verbose = _verbose; }
+
+  // Submit a snapshot to the checkpointer every `interval` generations
+  void setCheckpointer(const std::shared_ptr<Checkpointer> _checkpointer,
+                       int interval = 1) {
+    checkpointer = _checkpointer;
+    checkpointInterval = std::max(1, interval);
   }
 
   // Initialize the population
   template <typename DerivedIndividual, typename... Args>
   auto initialize(Args&&... args) noexcept {
+    generation = 0;
+    scores.clear();
+    feasibilityRatios.clear();
     population.clear();
     for (int i = 0; i < population_size; i++) {
       auto individual =
-          std::make_shared<DerivedIndividual>(std::forward<Args>(args)...);
+          std::make_shared<DerivedIndividual>(rng, std::forward<Args>(args)...);
       population.push_back(individual);
     }
   }
 
-  // Select an individual from the population using roulette wheel selection
-  auto selection() const noexcept {
+  // Replace the first individuals of an initialized population, e.g. with
+  // solutions of a related problem to warm-start the search
+  void inject(const std::vector<std::shared_ptr<IIndividual>>& individuals) {
+    int num = std::min(individuals.size(), population.size());
+    for (int i = 0; i < num; i++) population[i] = individuals[i];
+  }
+
+  // Evaluate the population, ranking it by the surrogate when enabled
+  void evaluate() noexcept {
+    int size = static_cast<int>(population.size());
+    scores.assign(size, 0);
+    exact.assign(size, false);
+    feasible.assign(size, false);
+
+    // Repaired individuals are predicted and evaluated as repaired
+    if (handling == ConstraintHandling::Repair)
+      Runtime::parallelFor(scheduler, size,
+                           [&](int i) { population[i]->repair(); });
+
+    std::vector<int> order(size);
+    for (int i = 0; i < size; i++) order[i] = i;
+
+    std::vector<std::vector<double>> features(size);
+    std::vector<double> predicted(size, 0.0);
+    int exact_num = size;
+
+    if (topFraction > 0 && surrogate.isReady()) {
+      for (int i = 0; i < size; i++) {
+        features[i] = population[i]->features();
+        predicted[i] = surrogate.predict(features[i]);
+      }
+
+      std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return predicted[a] < predicted[b];
+      });
+      exact_num = std::max(1, static_cast<int>(std::ceil(topFraction * size)));
+
+      // The rest keeps its predicted cost
+      for (int r = exact_num; r < size; r++) {
+        scores[order[r]] = static_cast<int>(std::min<double>(
+            predicted[order[r]], std::numeric_limits<int>::max()));
+        statistics.surrogateSkipped++;
+      }
+    }
+
+    // Exact evaluations run in parallel; everything that depends on their
+    // order stays sequential, so results do not depend on the thread count
+    Runtime::parallelFor(scheduler, exact_num, [&](int r) {
+      int i = order[r];
+      bool is_feasible = false;
+      scores[i] = score(*population[i], is_feasible);
+      feasible[i] = is_feasible;
+    });
+
+    int feasible_num = 0;
+    for (int r = 0; r < exact_num; r++) {
+      int i = order[r];
+      exact[i] = true;
+      statistics.evaluations++;
+      if (feasible[i]) feasible_num++;
+
+      // Rejected candidates carry no cost information to learn from
+      if (topFraction <= 0 || scores[i] == std::numeric_limits<int>::max())
+        continue;
+
+      if (features[i].empty()) features[i] = population[i]->features();
+      if (surrogate.isReady()) {
+        statistics.surrogateErrorSum +=
+            std::abs(predicted[i] - scores[i]) / std::max(1.0, 1.0 * scores[i]);
+        statistics.surrogateErrorSamples++;
+      }
+      surrogate.train(features[i], scores[i]);
+    }
+
+    statistics.feasibleEvaluations += feasible_num;
+    feasibilityRatios.push_back(1.0 * feasible_num / std::max(1, exact_num));
+    updateBest();
+  }
+
+  // Score an individual under the constraint handling strategy
+  int score(const IIndividual& individual, bool& is_feasible) const {
+    constexpr int worst = std::numeric_limits<int>::max();
+
+    if (handling == ConstraintHandling::Encoding) {
+      auto decoded = individual.decode();
+      is_feasible = decoded->violation() <= 0;
+      return is_feasible ? decoded->fitness() : worst;
+    }
+
+    double violation = individual.violation();
+    is_feasible = violation <= 0;
+    if (is_feasible) return individual.fitness();
+    if (handling != ConstraintHandling::Penalty) return worst;
+
+    double cost = individual.fitness() * (1.0 + penalty * violation);
+    return static_cast<int>(std::min<double>(cost, worst));
+  }
+
+  // Keep the lowest exactly evaluated cost of a feasible solution seen so far
+  void updateBest() {
+    for (int i = 0; i < static_cast<int>(population.size()); i++) {
+      if (!exact[i] || !feasible[i]) continue;
+      if (best_individual && scores[i] >= best_score) continue;
+
+      best_individual = handling == ConstraintHandling::Encoding
+                            ? population[i]->decode()
+                            : population[i];
+      best_score = scores[i];
+    }
+  }
+
+  // Select an individual from the population using roulette wheel selection;
+  // scores are costs, so the wheel is weighted by their inverse
+  auto selection() noexcept {
+    auto weight = [](int score) { return 1.0 / std::max(1, score); };
+
     // Calculate the total fitness of all individuals
     double totalFitness = 0.0;
-    for (const auto& individual : population) {
-      totalFitness += individual->fitness();
+    for (const auto& score : scores) {
+      totalFitness += weight(score);
     }
 
     // Generate a random number between 0 and totalFitness
-    double randValue = rand() / static_cast<double>(RAND_MAX) * totalFitness;
+    double randValue = rng.uniformReal() * totalFitness;
 
     // Select an individual based on the random value and cumulative fitness
     double cumulativeFitness = 0.0;
-    for (const auto& individual : population) {
-      cumulativeFitness += individual->fitness();
+    for (int i = 0; i < static_cast<int>(population.size()); i++) {
+      cumulativeFitness += weight(scores[i]);
       if (cumulativeFitness >= randValue) {
-        return individual;  // Select this individual
+        return population[i];  // Select this individual
       }
     }
 
@@ -120,44 +273,151 @@ class GeneticAlgorithm {
     return population.back();
   }
 
+  // Encode the whole search state, including the random stream
+  void save(BinaryWriter& writer) const {
+    writer.write(generation);
+    writer.write(rng.getState());
+
+    writer.write<uint32_t>(population.size());
+    for (const auto& individual : population) individual->save(writer);
+    writer.writeVector(scores);
+    writer.writeBits(exact);
+    writer.writeBits(feasible);
+
+    writer.write<uint8_t>(best_individual != nullptr);
+    if (best_individual) best_individual->save(writer);
+    writer.write(best_score);
+
+    writer.write(statistics);
+    writer.writeVector(feasibilityRatios);
+    surrogate.save(writer);
+  }
+
+  // Restore a search saved by save(); run() then continues where it stopped
+  template <typename DerivedIndividual, typename... Args>
+  bool restore(BinaryReader& reader, Args&&... args) {
+    // Individuals are built from a scratch stream and then overwritten
+    Random scratch;
+    auto make = [&] {
+      auto individual = std::make_shared<DerivedIndividual>(scratch, args...);
+      individual->load(reader);
+      return individual;
+    };
+
+    generation = reader.read<int>();
+    rng.setState(reader.read<std::array<uint64_t, 4>>());
+
+    population.clear();
+    auto size = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < size && reader.isGood(); i++)
+      population.push_back(make());
+    scores = reader.readVector<int>();
+    exact = reader.readBits();
+    feasible = reader.readBits();
+
+    best_individual = reader.read<uint8_t>() ? make() : nullptr;
+    best_score = reader.read<int>();
+
+    statistics = reader.read<SearchStatistics>();
+    feasibilityRatios = reader.readVector<double>();
+    surrogate.load(reader);
+    return reader.isGood();
+  }
+
   // Run the genetic algorithm
   void run() noexcept {
-    // Compare two individuals based on their fitness
-    auto compare = [&](const auto& a, const auto& b) {
-      return a->fitness() < b->fitness();
-    };
+    while (step()) {
+    }
+  }
 
-    for (int j = 0; j < generations; j++) {
-      decltype(population) new_population;
+  // Run one generation, evaluating the initial population first; false
+  // once the search is over
+  bool step() noexcept {
+    // A restored search continues with its saved population
+    if (scores.size() != population.size()) evaluate();
 
-      for (int i = 0; i < population_size; i++) {
-        auto parent1 = selection();
-        auto parent2 = selection();
+    if (generation >= generations) return false;
+    if (token && token->isCancelled()) return false;
 
-        decltype(parent1) child;
-        if ((rand() % 100) < crossover_rate * 100) {
-          child = parent1->crossover(parent2);
-        } else {
-          child = parent1->clone();
-        }
+    decltype(population) new_population;
 
-        if ((rand() % 100) < mutation_rate * 100) {
-          child->mutate();
-        }
-        new_population.emplace_back(child);
+    for (int i = 0; i < population_size; i++) {
+      auto parent1 = selection();
+      auto parent2 = selection();
+
+      decltype(parent1) child;
+      if (rng.bernoulli(crossover_rate)) {
+        child = parent1->crossover(parent2, rng);
+      } else {
+        child = parent1->clone();
       }
 
-      population = std::move(new_population);
+      if (rng.bernoulli(mutation_rate)) {
+        child->mutate(rng);
+      }
+      new_population.emplace_back(child);
+    }
 
-      best_individual =
-          *std::max_element(population.begin(), population.end(), compare);
+    population = std::move(new_population);
+    evaluate();
+    refineElites();
 
-      best_individual->print();
+    if (verbose && best_individual) best_individual->print();
 
-      if (best_individual->fitness() == 28) {
-        break;
-      }
+    generation++;
+    if (checkpointer && generation % checkpointInterval == 0) {
+      BinaryWriter writer;
+      save(writer);
+      checkpointer->submit(writer.getBuffer());
+    }
+
+    return best_score != 28 && generation < generations;
+  }
+
+  // Refine the cheapest exactly evaluated feasible individuals
+  void refineElites() {
+    if (!refine || elites <= 0) return;
+
+    std::vector<int> ranked;
+    for (int i = 0; i < static_cast<int>(population.size()); i++)
+      if (exact[i] && feasible[i]) ranked.push_back(i);
+
+    int num = std::min<int>(elites, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + num, ranked.end(),
+                      [&](int a, int b) { return scores[a] < scores[b]; });
+    for (int r = 0; r < num; r++) {
+      int i = ranked[r];
+      scores[i] = refine(*population[i], scores[i]);
     }
+    updateBest();
+  }
+
+  // Replace the worst individual of an evaluated population with a
+  // feasible solution found elsewhere and its exact cost
+  void adopt(const std::shared_ptr<IIndividual>& individual, int score) {
+    if (population.empty() || scores.size() != population.size()) return;
+
+    int worst = std::max_element(scores.begin(), scores.end()) - scores.begin();
+    population[worst] = individual;
+    scores[worst] = score;
+    exact[worst] = true;
+    feasible[worst] = true;
+    updateBest();
+  }
+
+  // Get the best individual
+  auto getBestIndividual() const noexcept { return best_individual; }
+
+  // Get the cost of the best individual
+  auto getBestScore() const noexcept { return best_score; }
+
+  // Get the search statistics
+  auto getStatistics() const noexcept { return statistics; }
+
+  // Get the fraction of feasible exact evaluations of every generation,
+  // the initial population first
+  const auto& getFeasibilityRatios() const noexcept {
+    return feasibilityRatios;
   }
 
  private:
@@ -173,11 +433,66 @@ class GeneticAlgorithm {
   // The crossover rate
   float crossover_rate;
 
+  // Random stream of the search
+  Random rng;
+
   // The population
   std::vector<std::shared_ptr<IIndividual>> population;
 
+  // Cached fitness of the population
+  std::vector<int> scores;
+
+  // Whether each score comes from an exact evaluation
+  std::vector<bool> exact;
+
+  // Whether each individual is feasible as evaluated
+  std::vector<bool> feasible;
+
+  // Feasible fraction of the exact evaluations of every generation
+  std::vector<double> feasibilityRatios;
+
+  // Treatment of infeasible individuals
+  ConstraintHandling handling = ConstraintHandling::Reject;
+
+  // Penalty factor of ConstraintHandling::Penalty
+  double penalty = 1.0;
+
   // The best individual
   std::shared_ptr<IIndividual> best_individual;
+
+  // The cost of the best individual
+  int best_score = std::numeric_limits<int>::max();
+
+  // Local search of the elites of every generation, and their number
+  std::function<int(IIndividual&, int)> refine;
+  int elites = 0;
+
+  // Fraction of each generation evaluated exactly under the surrogate
+  double topFraction = 0.0;
+
+  // Surrogate cost model
+  SurrogateModel surrogate;
+
+  // Search statistics
+  SearchStatistics statistics;
+
+  // Scheduler of the evaluations, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Cancellation of the search
+  std::shared_ptr<Runtime::CancellationToken> token;
+
+  // Next generation to run
+  int generation = 0;
+
+  // Whether the best individual is printed after every generation
+  bool verbose = false;
+
+  // Writer of periodic snapshots
+  std::shared_ptr<Checkpointer> checkpointer;
+
+  // Generations between snapshots
+  int checkpointInterval = 1;
 };
 }  // namespace Algorithm
 
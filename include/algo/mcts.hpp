@@ -1,80 +1,122 @@
-#ifndef GENETIC_HPP
-#define GENETIC_HPP
+#ifndef MCTS_HPP
+#define MCTS_HPP
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
 
+#include "algo/random.hpp"
+#include "checkpoint.hpp"
 #include "dnn/group.hpp"
 
 namespace Algorithm {
+// State of a sequential decision problem: actions are numbered from 0 to
+// getActionNum() - 1 and terminal states have a cost, lower is better
 class IState {
  public:
-  // Take a random action and return the next state
-  virtual std::shared_ptr<IState> takeAction(bool random) = 0;
+  virtual ~IState() {}
 
-  // Check if all actions are expanded
-  virtual bool isAllExpanded() const = 0;
+  // Get the number of actions available in the state
+  virtual int getActionNum() const = 0;
+
+  // Take an action and return the next state
+  virtual std::shared_ptr<IState> takeAction(int action) const = 0;
 
   // Check if the state is terminated
   virtual bool isTerminated() const = 0;
 
-  // Evaluate the state
+  // Evaluate a terminated state
   virtual int evaluate() const = 0;
 
+  // Hash of the state; states reached through different action orders must
+  // hash equal so the search can merge them
+  virtual uint64_t hash() const = 0;
+
   virtual void print() const = 0;
+
+  // Encode the state into a checkpoint
+  virtual void save(BinaryWriter& writer) const = 0;
 };
 
 class Node {
  public:
-  Node(const std::shared_ptr<IState> _state,
-       const std::shared_ptr<Node> _parent = nullptr)
-      : state(_state), parent(_parent) {}
+  Node(const std::shared_ptr<IState> _state) : state(_state) {}
 
   // Get state
   auto getState() const noexcept { return state; }
 
-  // Get parent node
-  auto getParent() const noexcept { return parent; }
-
-  // Set parent node
-  void setParent(const std::shared_ptr<Node> _parent) { parent = _parent; }
-
   // Get children nodes
-  auto getChildren() const noexcept { return children; }
+  const auto& getChildren() const noexcept { return children; }
 
   // Add child node
   void addChild(const std::shared_ptr<Node> child) {
     children.push_back(child);
   }
 
-  int visits;
+  // Check if all actions are expanded
+  bool isAllExpanded() const noexcept { return shuffled && untried.empty(); }
+
+  // Pop the next untried action, visiting actions in a random order
+  int nextAction(Random& rng) {
+    if (!shuffled) {
+      untried.resize(state->getActionNum());
+      std::iota(untried.begin(), untried.end(), 0);
+      std::shuffle(untried.begin(), untried.end(), rng);
+      shuffled = true;
+    }
 
-  int reward;
+    int action = untried.back();
+    untried.pop_back();
+    return action;
+  }
+
+  int visits = 0;
+
+  double reward = 0.0;
 
  private:
+  friend class MonteCarloTreeSearch;
+
   // State
   std::shared_ptr<IState> state;
 
-  // Parent node
-  std::shared_ptr<Node> parent;
-
-  // Children nodes
+  // Children nodes, shared with other parents through transpositions
   std::vector<std::shared_ptr<Node>> children;
+
+  // Actions not expanded yet
+  std::vector<int> untried;
+
+  // Whether the untried actions were drawn
+  bool shuffled = false;
 };
 
+// UCT search over a DAG of states. A transposition table keyed by the state
+// hash merges states reached through different action orders, so commuting
+// decisions share their statistics. Rollouts are rewarded with best / cost,
+// which keeps rewards in [0, 1] whatever the scale of the costs.
 class MonteCarloTreeSearch {
  public:
-  MonteCarloTreeSearch(int _budget, std::shared_ptr<Node> _root, bool _random)
-      : budget(_budget), root(_root), random(_random) {}
+  MonteCarloTreeSearch(int _budget, const std::shared_ptr<IState> root_state,
+                       uint64_t seed = 0)
+      : budget(_budget), rng(seed) {
+    root = lookup(root_state);
+  }
 
-  // Select the child with the highest value
-  auto select(std::shared_ptr<Node> node) const noexcept {
-    float best_score = -std::numeric_limits<float>::infinity();
+  // Select the child with the highest upper confidence bound
+  auto select(const std::shared_ptr<Node>& node) const noexcept {
+    double best_score = -std::numeric_limits<double>::infinity();
     std::shared_ptr<Node> best_node;
 
-    for (auto child : node->getChildren()) {
-      float avg = child->reward / child->visits;
-      float score = avg + std::sqrt(2 * std::log(node->visits) / child->visits);
+    for (const auto& child : node->getChildren()) {
+      // Children reached only through other parents may be unvisited
+      if (child->visits == 0) return child;
+
+      double avg = child->reward / child->visits;
+      double score = avg + std::sqrt(2 * std::log(std::max(1, node->visits)) /
+                                     child->visits);
 
       if (score > best_score) {
         best_score = score;
@@ -84,89 +126,253 @@ class MonteCarloTreeSearch {
     return best_node;
   }
 
-  // Expand the node by taking a random action
-  auto expand(const std::shared_ptr<Node> node) const noexcept {
-    auto state = node->getState();
-    state = state->takeAction(random);
+  // Expand the node by taking an untried action
+  auto expand(const std::shared_ptr<Node>& node) {
+    auto state = node->getState()->takeAction(node->nextAction(rng));
+    auto sub_node = lookup(state);
 
-    // Make new node
-    auto sub_node = std::make_shared<Node>(state, node);
-    node->addChild(sub_node);
+    auto& children = node->children;
+    if (std::find(children.begin(), children.end(), sub_node) ==
+        children.end())
+      node->addChild(sub_node);
 
     return sub_node;
   }
 
-  // Tree policy
-  auto treePolicy(std::shared_ptr<Node> node) const noexcept {
+  // Tree policy, returning the path from the root to the new leaf
+  auto treePolicy() {
+    std::vector<std::shared_ptr<Node>> path{root};
+    auto node = root;
+
     // Step while the state is not terminal
     while (!node->getState()->isTerminated()) {
       // If the node is not expanded, expand it
-      if (!node->getState()->isAllExpanded()) return expand(node);
+      if (!node->isAllExpanded()) {
+        path.push_back(expand(node));
+        break;
+      }
 
       // Select the child with the highest value
       node = select(node);
+      if (!node) break;
+      path.push_back(node);
     }
-    return node;
+    return path;
   }
 
   // Default policy
-  auto defaultPolicy(const std::shared_ptr<Node> node) const noexcept {
+  int defaultPolicy(const std::shared_ptr<Node>& node) noexcept {
     // Get the current state
     auto state = node->getState();
 
     // Simulate the game until the end
     while (!state->isTerminated()) {
       // Take random action
-      state = state->takeAction(random);
+      state = state->takeAction(rng.uniformInt(state->getActionNum()));
     }
 
-    int reward = state->evaluate();
-
-    return reward;
+    int cost = state->evaluate();
+    if (!best_state || cost < best_cost) {
+      best_cost = cost;
+      best_state = state;
+    }
+    return cost;
   }
 
-  // Backpropagate the result
-  void backPropagate(int reward, std::shared_ptr<Node> node) const noexcept {
-    // Backpropagate the result
-    while (node != nullptr) {
+  // Backpropagate the result along the selected path
+  void backPropagate(
+      int cost, const std::vector<std::shared_ptr<Node>>& path) const noexcept {
+    double reward = cost > 0 ? static_cast<double>(best_cost) / cost : 1.0;
+
+    for (const auto& node : path) {
       // Update the number of visits
       node->visits++;
 
       // Update the reward
       node->reward += reward;
+    }
+  }
+
+  // Submit a snapshot to the checkpointer every `interval` iterations
+  void setCheckpointer(const std::shared_ptr<Checkpointer> _checkpointer,
+                       int interval = 1) {
+    checkpointer = _checkpointer;
+    checkpointInterval = std::max(1, interval);
+  }
+
+  // Encode the iteration, random stream, best state and node statistics
+  void save(BinaryWriter& writer) const {
+    writer.write(iteration);
+    writer.write(rng.getState());
+
+    writer.write(best_cost);
+    writer.write<uint8_t>(best_state != nullptr);
+    if (best_state) best_state->save(writer);
 
-      // Get the parent node
-      node = node->getParent();
+    // Nodes in creation order, children by index
+    std::unordered_map<const Node*, uint32_t> index;
+    for (const auto& node : nodes) index.emplace(node.get(), index.size());
+
+    writer.write<uint32_t>(nodes.size());
+    for (const auto& node : nodes) {
+      writer.write(node->visits);
+      writer.write(node->reward);
+      node->getState()->save(writer);
+
+      writer.write<uint8_t>(node->shuffled);
+      writer.writeVector(node->untried);
+
+      std::vector<uint32_t> children;
+      for (const auto& child : node->children)
+        children.push_back(index.at(child.get()));
+      writer.writeVector(children);
     }
   }
 
+  // Restore a search saved by save(); search() then continues from it
+  bool restore(
+      BinaryReader& reader,
+      const std::function<std::shared_ptr<IState>(BinaryReader&)>& loadState) {
+    // Start over from the root state if the snapshot is damaged
+    auto root_state = root->getState();
+    auto stream = rng.getState();
+    auto fail = [&] {
+      rng.setState(stream);
+      iteration = 0;
+      best_cost = std::numeric_limits<int>::max();
+      best_state = nullptr;
+      nodes.clear();
+      table.clear();
+      root = lookup(root_state);
+      return false;
+    };
+
+    iteration = reader.read<int>();
+    rng.setState(reader.read<std::array<uint64_t, 4>>());
+
+    best_cost = reader.read<int>();
+    best_state = reader.read<uint8_t>() ? loadState(reader) : nullptr;
+
+    nodes.clear();
+    table.clear();
+
+    std::vector<std::vector<uint32_t>> children;
+    auto size = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < size && reader.isGood(); i++) {
+      int visits = reader.read<int>();
+      double reward = reader.read<double>();
+      auto state = loadState(reader);
+      if (!reader.isGood() || !state) return fail();
+
+      auto node = lookup(state);
+      node->visits = visits;
+      node->reward = reward;
+      node->shuffled = reader.read<uint8_t>();
+      node->untried = reader.readVector<int>();
+      children.push_back(reader.readVector<uint32_t>());
+    }
+
+    // Link the children once every node exists
+    for (size_t i = 0; i < children.size(); i++) {
+      for (auto c : children[i]) {
+        if (c >= nodes.size()) return fail();
+        nodes[i]->addChild(nodes[c]);
+      }
+    }
+
+    if (!reader.isGood() || nodes.empty()) return fail();
+    root = nodes.front();
+    return true;
+  }
+
   // Search
-  auto search() const noexcept {
+  void search() {
     // Run computation budget times
-    for (int _ = 0; _ < budget; _++) {
+    while (iteration < budget) {
       // 1. Select or create a leaf node from the nodes already contained
       // within the search tree
-      auto expand_node = treePolicy(root);
+      auto path = treePolicy();
 
       // 2.Play out the domain from a given nonterminal state to produce a
       // value estimate
-      int reward = defaultPolicy(expand_node);
+      int cost = defaultPolicy(path.back());
 
       // 3. Updates node statistics that inform future tree policy decisions.
-      backPropagate(reward, expand_node);
+      backPropagate(cost, path);
+
+      iteration++;
+      if (checkpointer && iteration % checkpointInterval == 0) {
+        BinaryWriter writer;
+        save(writer);
+        checkpointer->submit(writer.getBuffer());
+      }
     }
   }
 
+  // Set the number of iterations search() runs up to, e.g. to continue a
+  // finished search for more
+  void setBudget(int _budget) noexcept { budget = _budget; }
+
+  // Get the number of iterations run
+  auto getIteration() const noexcept { return iteration; }
+
+  // Get the lowest cost of a terminal state seen so far
+  auto getBestCost() const noexcept { return best_cost; }
+
+  // Get the terminal state with the lowest cost
+  auto getBestState() const noexcept { return best_state; }
+
+  // Get the number of distinct states in the tree
+  auto getNodeNum() const noexcept { return nodes.size(); }
+
+  // Get the number of expansions that reached an existing state
+  auto getTranspositions() const noexcept { return transpositions; }
+
  private:
+  // Find the node of a state, creating it on first sight
+  std::shared_ptr<Node> lookup(const std::shared_ptr<IState>& state) {
+    auto [it, inserted] = table.try_emplace(state->hash());
+    if (!inserted) {
+      transpositions++;
+      return it->second;
+    }
+
+    it->second = std::make_shared<Node>(state);
+    nodes.push_back(it->second);
+    return it->second;
+  }
+
   // Computation budget
   int budget;
 
   // Root node
   std::shared_ptr<Node> root;
 
-  // Random
-  bool random;
+  // Random stream of the search
+  Random rng;
+
+  // Nodes by state hash
+  std::unordered_map<uint64_t, std::shared_ptr<Node>> table;
+
+  // Nodes in creation order
+  std::vector<std::shared_ptr<Node>> nodes;
+
+  // Number of expansions merged into existing nodes
+  long long transpositions = 0;
+
+  // Best terminal state of the rollouts
+  std::shared_ptr<IState> best_state;
+  int best_cost = std::numeric_limits<int>::max();
+
+  // Next iteration to run
+  int iteration = 0;
+
+  // Writer of periodic snapshots
+  std::shared_ptr<Checkpointer> checkpointer;
+
+  // Iterations between snapshots
+  int checkpointInterval = 1;
 };
 
 }  // namespace Algorithm
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,110 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace Algorithm {
+// xoshiro256** generator. Each search owns its generator, so runs are
+// reproducible from a seed and threads never contend on a global state.
+// Independent streams are derived by jumping 2^128 steps ahead, which keeps
+// per-worker sequences from overlapping.
+class Random {
+ public:
+  using result_type = uint64_t;
+
+  explicit Random(uint64_t seed = 0) noexcept { reseed(seed); }
+
+  // Stream `index` of the generator seeded with `seed`
+  static Random stream(uint64_t seed, int index) noexcept {
+    Random rng(seed);
+    for (int i = 0; i < index; i++) rng.jump();
+    return rng;
+  }
+
+  // Derive a seed for a sub-search from a parent seed and a salt
+  static uint64_t derive(uint64_t seed, uint64_t salt) noexcept {
+    uint64_t x = seed ^ (salt * 0x9e3779b97f4a7c15ULL);
+    return splitmix(x);
+  }
+
+  static constexpr result_type min() noexcept { return 0; }
+
+  static constexpr result_type max() noexcept {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  void reseed(uint64_t seed) noexcept {
+    uint64_t x = seed;
+    for (auto& word : s) word = splitmix(x);
+  }
+
+  result_type operator()() noexcept {
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+  }
+
+  // Uniform integer in [0, n)
+  int uniformInt(int n) noexcept {
+    return static_cast<int>((static_cast<unsigned __int128>((*this)()) * n) >>
+                            64);
+  }
+
+  // Uniform real in [0, 1)
+  double uniformReal() noexcept { return ((*this)() >> 11) * 0x1.0p-53; }
+
+  // True with the given probability
+  bool bernoulli(double p) noexcept { return uniformReal() < p; }
+
+  // Advance the generator by 2^128 steps
+  void jump() noexcept {
+    static constexpr uint64_t JUMP[] = {0x180ec6d33cfd0abaULL,
+                                        0xd5a61266f0c9392cULL,
+                                        0xa9582618e03fc9aaULL,
+                                        0x39abdc4529b1661cULL};
+
+    std::array<uint64_t, 4> t{};
+    for (auto word : JUMP) {
+      for (int b = 0; b < 64; b++) {
+        if (word & (1ULL << b))
+          for (int i = 0; i < 4; i++) t[i] ^= s[i];
+        (*this)();
+      }
+    }
+    s = t;
+  }
+
+  // Get the raw state, e.g. to store it
+  const auto& getState() const noexcept { return s; }
+
+  // Restore a raw state
+  void setState(const std::array<uint64_t, 4>& _s) noexcept { s = _s; }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) noexcept {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  static uint64_t splitmix(uint64_t& x) noexcept {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // Generator state
+  std::array<uint64_t, 4> s;
+};
+}  // namespace Algorithm
+
+#endif
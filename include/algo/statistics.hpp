@@ -0,0 +1,44 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+namespace Algorithm {
+struct SearchStatistics {
+  // Exact evaluations of the cost model
+  long long evaluations = 0;
+
+  // Exact evaluations of feasible candidates
+  long long feasibleEvaluations = 0;
+
+  // Candidates ranked by the surrogate and never evaluated exactly
+  long long surrogateSkipped = 0;
+
+  // Accumulated relative error of the surrogate on exactly evaluated
+  // candidates, measured before the surrogate was trained on them
+  double surrogateErrorSum = 0.0;
+
+  // Number of predictions the error is accumulated over
+  long long surrogateErrorSamples = 0;
+
+  // Add the statistics of another search
+  void add(const SearchStatistics& other) noexcept {
+    evaluations += other.evaluations;
+    feasibleEvaluations += other.feasibleEvaluations;
+    surrogateSkipped += other.surrogateSkipped;
+    surrogateErrorSum += other.surrogateErrorSum;
+    surrogateErrorSamples += other.surrogateErrorSamples;
+  }
+
+  // Fraction of the exact evaluations that were feasible
+  double feasibility() const noexcept {
+    return evaluations ? 1.0 * feasibleEvaluations / evaluations : 0.0;
+  }
+
+  // Mean relative prediction error of the surrogate
+  double surrogateError() const noexcept {
+    return surrogateErrorSamples ? surrogateErrorSum / surrogateErrorSamples
+                                 : 0.0;
+  }
+};
+}  // namespace Algorithm
+
+#endif
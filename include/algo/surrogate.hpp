@@ -0,0 +1,131 @@
+#ifndef SURROGATE_HPP
+#define SURROGATE_HPP
+
+#include <cmath>
+#include <vector>
+
+#include "serialize.hpp"
+
+namespace Algorithm {
+// Online ridge regression on log-cost. The normal equations are accumulated
+// sample by sample and solved by Cholesky decomposition on demand, so the
+// model is deterministic and needs nothing beyond the standard library.
+class SurrogateModel {
+ public:
+  SurrogateModel(double _lambda = 1e-2, int _warmup = 32)
+      : lambda(_lambda), warmup(_warmup) {}
+
+  // Check if enough samples were seen to trust the predictions
+  bool isReady() const noexcept { return samples >= warmup; }
+
+  // Add an exactly evaluated sample
+  void train(const std::vector<double>& features, double cost) noexcept {
+    if (xtx.empty()) {
+      size = static_cast<int>(features.size()) + 1;
+      xtx.assign(size * size, 0.0);
+      xty.assign(size, 0.0);
+    }
+
+    double y = std::log1p(std::max(0.0, cost));
+    for (int i = 0; i < size; i++) {
+      double xi = feature(features, i);
+      xty[i] += xi * y;
+      for (int j = 0; j < size; j++)
+        xtx[i * size + j] += xi * feature(features, j);
+    }
+
+    samples++;
+    dirty = true;
+  }
+
+  // Encode the trained state
+  void save(BinaryWriter& writer) const {
+    writer.write(samples);
+    writer.writeVector(xtx);
+    writer.writeVector(xty);
+  }
+
+  // Decode the trained state; the weights are solved again on demand
+  void load(BinaryReader& reader) {
+    samples = reader.read<int>();
+    xtx = reader.readVector<double>();
+    xty = reader.readVector<double>();
+    size = static_cast<int>(xty.size());
+    dirty = true;
+  }
+
+  // Predict the cost of a candidate
+  double predict(const std::vector<double>& features) noexcept {
+    if (xtx.empty()) return 0.0;
+    if (dirty) solve();
+
+    double y = 0.0;
+    for (int i = 0; i < size; i++) y += weights[i] * feature(features, i);
+    return std::expm1(y);
+  }
+
+ private:
+  // Feature i, with a constant bias term in front
+  static double feature(const std::vector<double>& features, int i) noexcept {
+    return i == 0 ? 1.0 : features[i - 1];
+  }
+
+  // Solve (XᵀX + λI) w = Xᵀy
+  void solve() noexcept {
+    std::vector<double> l(xtx);
+    for (int i = 0; i < size; i++) l[i * size + i] += lambda;
+
+    // In-place Cholesky decomposition, lower triangle
+    for (int j = 0; j < size; j++) {
+      double d = l[j * size + j];
+      for (int k = 0; k < j; k++) d -= l[j * size + k] * l[j * size + k];
+      d = std::sqrt(std::max(d, 1e-12));
+      l[j * size + j] = d;
+
+      for (int i = j + 1; i < size; i++) {
+        double v = l[i * size + j];
+        for (int k = 0; k < j; k++) v -= l[i * size + k] * l[j * size + k];
+        l[i * size + j] = v / d;
+      }
+    }
+
+    // Forward and backward substitution
+    weights.assign(size, 0.0);
+    for (int i = 0; i < size; i++) {
+      double v = xty[i];
+      for (int k = 0; k < i; k++) v -= l[i * size + k] * weights[k];
+      weights[i] = v / l[i * size + i];
+    }
+    for (int i = size - 1; i >= 0; i--) {
+      double v = weights[i];
+      for (int k = i + 1; k < size; k++) v -= l[k * size + i] * weights[k];
+      weights[i] = v / l[i * size + i];
+    }
+
+    dirty = false;
+  }
+
+  // Ridge regularisation strength
+  double lambda;
+
+  // Samples required before the model is used for ranking
+  int warmup;
+
+  // Number of trained samples
+  int samples = 0;
+
+  // Number of weights including the bias
+  int size = 0;
+
+  // Accumulated XᵀX (row major) and Xᵀy
+  std::vector<double> xtx, xty;
+
+  // Solved weights
+  std::vector<double> weights;
+
+  // Whether samples were added since the last solve
+  bool dirty = false;
+};
+}  // namespace Algorithm
+
+#endif
@@ -6,16 +6,25 @@
 namespace Architecture {
 struct Mesh {
   // Number of the core
-  int coreNum;
+  int coreNum = 16;
 
   // Footprint for one core
-  int footprintPerCore;
+  int footprintPerCore = 1 << 20;
 
   // Bandwidth of onchip memory
-  int onchipBandwidth;
+  int onchipBandwidth = 64;
 
   // Bandwidth of offchip memory
-  int offchipBandwidth;
+  int offchipBandwidth = 16;
+
+  // Multiply-accumulates one core retires per cycle
+  int computeThroughput = 64;
+
+  // Cores in one row of the mesh
+  int meshWidth = 4;
+
+  // Cycles to start one message over an onchip link
+  int linkLatency = 16;
 };
 }  // namespace Architecture
 
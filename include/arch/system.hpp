@@ -0,0 +1,34 @@
+#ifndef SYSTEM_HPP
+#define SYSTEM_HPP
+
+#include "arch/mesh.hpp"
+
+namespace Architecture {
+// Identical chips in a row, every neighbouring pair joined by a link
+struct System {
+  // Mesh of every chip
+  Mesh chip;
+
+  // Number of the chips
+  int chipNum = 4;
+
+  // Bytes per cycle of one inter-chip link
+  int chipBandwidth = 8;
+
+  // Cycles to start one message over an inter-chip link
+  int chipLatency = 1024;
+
+  // Get the chips as the cores of a one-row mesh, so that the collective
+  // models of a mesh apply to the links between them
+  Mesh getChipNetwork() const noexcept {
+    Mesh network;
+    network.coreNum = chipNum;
+    network.meshWidth = chipNum;
+    network.onchipBandwidth = chipBandwidth;
+    network.linkLatency = chipLatency;
+    return network;
+  }
+};
+}  // namespace Architecture
+
+#endif
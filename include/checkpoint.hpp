@@ -0,0 +1,123 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "serialize.hpp"
+
+// Writes search snapshots to disk on a background thread. Searches hand over
+// an encoded snapshot and continue immediately; if the writer is still busy,
+// a newer snapshot replaces the pending one. Files are written next to the
+// target and renamed into place, so a crash never leaves a torn checkpoint.
+class Checkpointer {
+ public:
+  explicit Checkpointer(const std::string& _path)
+      : path(_path), writer([this] { work(); }) {}
+
+  ~Checkpointer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    writer.join();
+  }
+
+  Checkpointer(const Checkpointer&) = delete;
+  Checkpointer& operator=(const Checkpointer&) = delete;
+
+  // Queue a snapshot for writing
+  void submit(std::vector<char> snapshot) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending = std::move(snapshot);
+    }
+    wakeup.notify_all();
+  }
+
+  // Wait until the latest submitted snapshot is on disk
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [&] { return !pending && !writing; });
+  }
+
+  // Read the checkpoint at a path
+  static std::optional<std::vector<char>> load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return std::nullopt;
+
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    BinaryReader reader(bytes);
+    if (reader.read<uint32_t>() != MAGIC || reader.read<uint32_t>() != VERSION)
+      return std::nullopt;
+
+    auto header = sizeof(uint32_t) * 2;
+    return std::vector<char>(bytes.begin() + header, bytes.end());
+  }
+
+  const auto& getPath() const noexcept { return path; }
+
+ private:
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      wakeup.wait(lock, [&] { return stopping || pending; });
+      if (!pending) return;
+
+      auto snapshot = std::move(*pending);
+      pending.reset();
+      writing = true;
+
+      lock.unlock();
+      write(snapshot);
+      lock.lock();
+
+      writing = false;
+      written.notify_all();
+    }
+  }
+
+  void write(const std::vector<char>& snapshot) const {
+    auto temporary = path + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      uint32_t header[2] = {MAGIC, VERSION};
+      file.write(reinterpret_cast<const char*>(header), sizeof(header));
+      file.write(snapshot.data(), snapshot.size());
+      if (!file) return;
+    }
+    std::rename(temporary.c_str(), path.c_str());
+  }
+
+  static constexpr uint32_t MAGIC = 0x4b434a4d;  // "MJCK"
+  static constexpr uint32_t VERSION = 2;
+
+  // Checkpoint file
+  std::string path;
+
+  // Snapshot waiting to be written
+  std::optional<std::vector<char>> pending;
+
+  // Whether the writer is on disk right now
+  bool writing = false;
+
+  // Whether the checkpointer is shutting down
+  bool stopping = false;
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable written;
+
+  // Writer thread, started last
+  std::thread writer;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef COST_BOUND_HPP
+#define COST_BOUND_HPP
+
+#include <cmath>
+
+#include "cost/kernel.hpp"
+
+namespace Cost {
+// Largest spatial, temporal and sharing factor the mappers draw for a
+// dimension. Local search may raise temporal and sharing factors further,
+// but spatial ones never, which the bound below relies on.
+constexpr int MAX_FACTOR = 4;
+
+// Smallest B * max(1, n / B) over every block number B. Tile sizes are
+// rounded down, so a partition may undercut the n iterations of a dimension,
+// but never below this
+inline long long getMinimalWork(int n) noexcept { return n / 2 + 1; }
+
+// Smallest iterations K * max(1, n / (s * K)) of a dimension on one core,
+// over spatial factors s up to MAX_FACTOR and K = temporal * sharing
+inline long long getMinimalCoreWork(int n) noexcept {
+  long long minimal = std::max(1, n);
+  for (int s = 1; s <= MAX_FACTOR; s++) {
+    for (int k = 1; k <= n / s + 1; k++) {
+      long long work = 1LL * k * std::max(1, n / (s * k));
+      minimal = std::min(minimal, work);
+    }
+  }
+  return minimal;
+}
+
+// Lower bound of the latency of every partition of a group: the compute
+// roof of its multiply-accumulates spread over all cores. Transfers are left
+// out, as the model charges the difference of on-chip and off-chip traffic,
+// which a partition can drive to zero.
+inline long long getCostBound(const Layout& layout,
+                              const Architecture::Mesh& mesh) {
+  // Multiply-accumulates of the group and of one tile step of a core
+  double work = 0.0;
+  double core_work = 0.0;
+
+  for (size_t op = 0; op < layout.operatorMasks.size(); op++) {
+    auto mask = layout.operatorMasks[op];
+    double op_work = layout.operatorWork[op];
+    double op_core_work = layout.operatorWork[op];
+    for (size_t i = 0; i < layout.dims.size(); i++) {
+      if (!(mask >> i & 1)) continue;
+
+      // Resident dimensions are never split
+      bool resident = layout.residentMask >> i & 1;
+      op_work *= resident ? layout.sizes[i] : getMinimalWork(layout.sizes[i]);
+      op_core_work *=
+          resident ? layout.sizes[i] : getMinimalCoreWork(layout.sizes[i]);
+    }
+    work += op_work;
+    core_work += op_core_work;
+  }
+
+  // Compute cycles are rounded down per core, costing up to one cycle of
+  // every throughput-many multiply-accumulates
+  double throughput = mesh.computeThroughput;
+  if (core_work <= throughput) return 0;
+
+  double bound =
+      work / (mesh.coreNum * throughput) * (1.0 - throughput / core_work);
+  return static_cast<long long>(std::floor(bound));
+}
+}  // namespace Cost
+
+#endif
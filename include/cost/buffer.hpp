@@ -0,0 +1,79 @@
+#ifndef COST_BUFFER_HPP
+#define COST_BUFFER_HPP
+
+#include <algorithm>
+#include <vector>
+
+namespace Cost {
+// Tile buffer of one core, live from the first to the last operator of a
+// tile step that uses it
+struct Block {
+  long long size;
+  int first;
+  int last;
+
+  // Offset assigned by the planner
+  long long offset = 0;
+};
+
+// How a footprint counts the buffers
+enum class Allocation {
+  // Peak of the offsets the planner assigns
+  Planned,
+  // Peak of the bytes live at once, a lower bound of any assignment
+  Live,
+  // Sum of every buffer, as if all were live at once
+  Total
+};
+
+// Assigns offsets so that buffers with overlapping live ranges never share
+// bytes: largest first, each at the lowest offset clear of the buffers
+// already placed over its range. Returns the bytes the buffers span.
+inline long long planOffsets(std::vector<Block>& blocks,
+                             std::vector<int>& order) {
+  order.resize(blocks.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    if (blocks[a].size != blocks[b].size)
+      return blocks[a].size > blocks[b].size;
+    return blocks[a].first < blocks[b].first;
+  });
+
+  long long peak = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    auto& block = blocks[order[i]];
+
+    // Raise the offset past every overlapping buffer in its way; placed
+    // buffers are visited until a full pass moves nothing
+    block.offset = 0;
+    for (bool moved = true; moved;) {
+      moved = false;
+      for (size_t j = 0; j < i; j++) {
+        const auto& placed = blocks[order[j]];
+        if (placed.last < block.first || block.last < placed.first) continue;
+        if (placed.offset + placed.size <= block.offset ||
+            block.offset + block.size <= placed.offset)
+          continue;
+        block.offset = placed.offset + placed.size;
+        moved = true;
+      }
+    }
+    peak = std::max(peak, block.offset + block.size);
+  }
+  return peak;
+}
+
+// Largest number of bytes live at one operator
+inline long long getLivePeak(const std::vector<Block>& blocks, int steps) {
+  long long peak = 0;
+  for (int s = 0; s < steps; s++) {
+    long long live = 0;
+    for (const auto& block : blocks)
+      if (block.first <= s && s <= block.last) live += block.size;
+    peak = std::max(peak, live);
+  }
+  return peak;
+}
+}  // namespace Cost
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef COST_COLLECTIVE_HPP
+#define COST_COLLECTIVE_HPP
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "arch/mesh.hpp"
+
+namespace Cost {
+// Algorithm combining the partial results of a spatially split reduction
+enum class Collective {
+  // Every core sends its partial result to one core in turn
+  Gather,
+  // Partial results travel around a ring in p - 1 chunked steps per phase
+  Ring,
+  // Recursive halving reduce-scatter, then recursive doubling all-gather
+  HalvingDoubling,
+  // Binomial trees along the rows, then along the columns of the mesh
+  MeshTree,
+  // Ring reduce-scatter, leaving every core a shard of the result
+  ReduceScatter
+};
+
+// Get the name of an algorithm
+inline std::string getCollectiveName(Collective collective) {
+  switch (collective) {
+    case Collective::Gather:
+      return "gather";
+    case Collective::Ring:
+      return "ring";
+    case Collective::HalvingDoubling:
+      return "halving-doubling";
+    case Collective::MeshTree:
+      return "mesh-tree";
+    default:
+      return "reduce-scatter";
+  }
+}
+
+// Steps of a binomial tree over n nodes
+inline int getTreeDepth(int n) noexcept {
+  int depth = 0;
+  while ((1 << depth) < n) depth++;
+  return depth;
+}
+
+// Steps of binomial trees along the rows, then along the columns, of the
+// cores a collective over `participants` cores fills row by row
+inline int getMeshDepth(int participants,
+                        const Architecture::Mesh& mesh) noexcept {
+  int columns = std::min(participants, std::max(1, mesh.meshWidth));
+  int rows = (participants + columns - 1) / columns;
+  return getTreeDepth(columns) + getTreeDepth(rows);
+}
+
+// Cycles of an algorithm reducing a result of `bytes` over `participants`
+// cores: every step costs the link latency plus its bytes over the onchip
+// bandwidth of the links it shares. With `allReduce`, every core needs the
+// whole result after; otherwise one core, or a shard on every core for the
+// reduce-scatter phases, suffices.
+inline long long getCollectiveCycles(Collective collective, long long bytes,
+                                     int participants, bool allReduce,
+                                     const Architecture::Mesh& mesh) {
+  long long p = participants;
+  if (p <= 1) return 0;
+
+  long long alpha = mesh.linkLatency;
+  double beta = 1.0 / mesh.onchipBandwidth;
+  int depth = getMeshDepth(participants, mesh);
+  double cycles = 0.0;
+
+  switch (collective) {
+    case Collective::Gather:
+      // The links into the root carry every partial result
+      cycles = (p - 1) * (alpha + bytes * beta);
+      break;
+    case Collective::Ring:
+      // Neighbouring cores of a ring snaking through the mesh
+      cycles = 2 * (p - 1) * (alpha + bytes * beta / p);
+      break;
+    case Collective::HalvingDoubling:
+      // The exchange at distance d halves the data, but d exchanges share
+      // each link of the row or column
+      cycles = depth * (alpha + bytes * beta / 2);
+
+      // Cores beyond a power of two first fold into a partner
+      if (p & (p - 1)) cycles += alpha + bytes * beta;
+      break;
+    case Collective::MeshTree:
+      // Senders of a step are spaced so that no two share a link
+      cycles = depth * (alpha + bytes * beta);
+      break;
+    case Collective::ReduceScatter:
+      if (allReduce) return std::numeric_limits<long long>::max();
+      cycles = (p - 1) * (alpha + bytes * beta / p);
+      break;
+  }
+
+  // The all-gather or broadcast back mirrors the reduction
+  if (allReduce && collective != Collective::Ring) cycles *= 2;
+  return static_cast<long long>(cycles);
+}
+
+// Cycles of a ring all-gather over `participants` cores, each holding one
+// shard of a result of `bytes` and ending with all of it
+inline long long getAllGatherCycles(long long bytes, int participants,
+                                    const Architecture::Mesh& mesh) {
+  long long p = participants;
+  if (p <= 1) return 0;
+
+  double beta = 1.0 / mesh.onchipBandwidth;
+  return static_cast<long long>((p - 1) *
+                                (mesh.linkLatency + bytes * beta / p));
+}
+
+// Cheapest algorithm of a reduction and its cycles
+inline std::pair<Collective, long long> pickCollective(
+    long long bytes, int participants, bool allReduce,
+    const Architecture::Mesh& mesh) {
+  std::pair<Collective, long long> best{Collective::Gather,
+                                        std::numeric_limits<long long>::max()};
+  for (auto collective :
+       {Collective::Gather, Collective::Ring, Collective::HalvingDoubling,
+        Collective::MeshTree, Collective::ReduceScatter}) {
+    auto cycles =
+        getCollectiveCycles(collective, bytes, participants, allReduce, mesh);
+    if (cycles < best.second) best = {collective, cycles};
+  }
+  return best;
+}
+}  // namespace Cost
+
+#endif
@@ -0,0 +1,587 @@
+#ifndef COST_KERNEL_HPP
+#define COST_KERNEL_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include "arch/mesh.hpp"
+#include "cost/buffer.hpp"
+#include "cost/collective.hpp"
+#include "dnn/group.hpp"
+
+using PartitionVector =
+    std::unordered_map<DNN::Dimension, std::tuple<int, int, int>,
+                       DNN::DimensionHash>;
+
+namespace Cost {
+// Index form of an operator group, compiled once per group. Dimensions are
+// numbered, tensors become lists of dimension indices and every membership
+// test a bit mask. Setting a mapping looks each dimension up once by name;
+// the cost terms then only index arrays.
+struct Layout {
+  // Tensor of one operator
+  struct Access {
+    // Indices of the tensor dimensions
+    std::vector<int> dims;
+
+    // Bit i is set if the tensor has dimension i
+    uint64_t mask = 0;
+
+    // Whether the tensor stays within the group, and whether an earlier
+    // operator of the group already touches it
+    bool fused = false;
+    bool repeated = false;
+
+    // Bytes of an element moved to and from memory, and of an element held
+    // in the buffer: staged reduction outputs accumulate in a wider type
+    int bytes = 4;
+    int bufferBytes = 4;
+
+    // Sweeps over an input of a normalization whose axis is split, and the
+    // index of that axis (-1 for other tensors)
+    int passes = 1;
+    int axis = -1;
+
+    // Loops re-running the operator, and for a stored fused tensor the
+    // loops over other dimensions its tiles have to outlive
+    uint64_t steps = 0;
+    uint64_t hold = 0;
+  };
+
+  // Reduction of an operator output over the dimensions of a mask. An
+  // output consumed within the group needs the whole result on every core;
+  // one leaving it may be written back in shards.
+  struct Reduction {
+    uint64_t mask;
+    int access;
+    bool allReduce;
+  };
+
+  // Buffer of a tensor, by its first access, used from the first to the
+  // last operator; or of the running state of an online softmax
+  struct Buffer {
+    int access;
+    int state;
+    int first;
+    int last;
+  };
+
+  // Output of an operator rescaled whenever an online softmax before it
+  // moves along its axis
+  struct Rescale {
+    int op;
+    int access;
+  };
+
+  // Operations per element of a rescaled output, and bytes per element of
+  // the running maximum and sum of an online softmax
+  static constexpr int RESCALE_WORK = 2;
+  static constexpr int STATE_BYTES = 8;
+
+  explicit Layout(const DNN::OperatorGroup& group) {
+    const auto& [operators, tensors, dimensions, internalTensors,
+                 externalTensors] = group.getGroupInfo();
+
+    dims.assign(dimensions.begin(), dimensions.end());
+    for (int i = 0; i < static_cast<int>(dims.size()); i++) {
+      index.emplace(dims[i], i);
+      sizes.push_back(dims[i].getSize());
+    }
+
+    for (const auto& dim : group.getResidentDimensions())
+      residentMask |= bit(dim);
+
+    int op_num = operators.size();
+    auto find = [&](const DNN::Operator& op) {
+      return std::find(operators.begin(), operators.end(), op) -
+             operators.begin();
+    };
+
+    for (const auto& op : operators) {
+      uint64_t op_mask = 0;
+      for (const auto& dim : op.getDimensions()) op_mask |= bit(dim);
+      operatorMasks.push_back(op_mask);
+      operatorWork.push_back(op.getWorkPerPoint());
+    }
+
+    // An operator runs once per tile of its own dimensions. Recomputed
+    // producers run again for every tile of their consumers, which may in
+    // turn be recomputed, so the loops propagate up to a fixed point.
+    operatorSteps = operatorMasks;
+    recompute = group.getFusedTensorMode() == DNN::FusedTensorMode::Recompute;
+    for (int pass = 0; recompute && pass < op_num; pass++)
+      for (int o = 0; o < op_num; o++)
+        for (const auto& tensor : operators[o].getOutputs())
+          if (internalTensors.count(tensor))
+            for (const auto& consumer : group.getConsumers(tensor))
+              operatorSteps[o] |= operatorSteps[find(consumer)];
+
+    // Loops of the producer and the consumers of every tensor
+    auto getUsers = [&](const DNN::Tensor& tensor) {
+      uint64_t users = 0;
+      for (int o = 0; o < op_num; o++) {
+        const auto& op_tensors = operators[o].getTensors();
+        if (std::count(op_tensors.begin(), op_tensors.end(), tensor))
+          users |= operatorSteps[o];
+      }
+      return users;
+    };
+
+    std::vector<int> first;
+    std::unordered_map<DNN::Tensor, int, DNN::TensorHash> seen;
+    for (int o = 0; o < op_num; o++) {
+      const auto& op = operators[o];
+      first.push_back(accesses.size());
+
+      // Tensors in the order the operator lists them, inputs first
+      int inputs = op.getInputs().size();
+      for (const auto& tensor : op.getTensors()) {
+        Access access;
+        for (const auto& dim : tensor.getDimensions()) {
+          access.dims.push_back(index.at(dim));
+          access.mask |= bit(dim);
+        }
+        access.fused = internalTensors.count(tensor);
+        auto [buffer, inserted] = seen.emplace(tensor, buffers.size());
+        access.repeated = !inserted;
+        if (inserted)
+          buffers.push_back({static_cast<int>(accesses.size()), -1, o, o});
+        else
+          buffers[buffer->second].last = o;
+        access.bytes = DNN::getByteSize(group.getStorageType(tensor));
+        access.bufferBytes = access.bytes;
+        access.steps = operatorSteps[o];
+        if (access.fused && !recompute)
+          access.hold = getUsers(tensor) & ~access.mask;
+
+        bool input = inputs-- > 0;
+        if (input && op.getAxis() && op.getPasses() > 1 &&
+            !group.isOnline(op)) {
+          access.passes = op.getPasses();
+          access.axis = index.at(*op.getAxis());
+        }
+        rank = std::max<int>(rank, access.dims.size());
+        accesses.push_back(access);
+      }
+
+      // Outputs accumulate partial sums over the reduction dimensions
+      int outputs = op.getOutputs().size();
+      int last = accesses.size();
+      uint64_t reduced = 0;
+      for (const auto& dim : op.getReductionDimensions()) reduced |= bit(dim);
+      for (int a = last - outputs; a < last && reduced; a++) {
+        auto type = op.getOutputs()[a - last + outputs].getType();
+        if (!accesses[a].fused)
+          accesses[a].bufferBytes =
+              DNN::getByteSize(DNN::getAccumulatorType(type));
+        reductions.push_back({reduced, a, accesses[a].fused});
+      }
+    }
+
+    // Online softmaxes keep a running maximum and sum per row and rescale
+    // the outputs of their consumers
+    for (const auto& op : operators) {
+      if (!group.isOnline(op)) continue;
+
+      for (const auto& tensor : op.getOutputs()) {
+        uint64_t row = 0;
+        for (const auto& dim : tensor.getDimensions())
+          if (dim.getName() != op.getAxis()->getName()) row |= bit(dim);
+        buffers.push_back({-1, static_cast<int>(states.size()), 0, op_num - 1});
+        states.push_back(row);
+
+        for (const auto& consumer : group.getConsumers(tensor)) {
+          int c = find(consumer);
+          int outputs = consumer.getOutputs().size();
+          int end = first[c] + consumer.getTensors().size();
+          for (int a = end - outputs; a < end; a++) rescales.push_back({c, a});
+        }
+      }
+    }
+  }
+
+  // Get the index of a dimension
+  int getIndex(const DNN::Dimension& dim) const { return index.at(dim); }
+
+  // Group dimensions and their sizes, by index
+  std::vector<DNN::Dimension> dims;
+  std::vector<int> sizes;
+
+  // Tensors of every operator, in operator order
+  std::vector<Access> accesses;
+
+  // Dimension mask, operations per point and loops re-running every
+  // operator
+  std::vector<uint64_t> operatorMasks;
+  std::vector<int> operatorWork;
+  std::vector<uint64_t> operatorSteps;
+
+  // Bit i is set if every tile holds dimension i whole
+  uint64_t residentMask = 0;
+
+  // Reductions of every operator
+  std::vector<Reduction> reductions;
+
+  // Outputs rescaled by online softmaxes, and the row masks of their
+  // running states
+  std::vector<Rescale> rescales;
+  std::vector<uint64_t> states;
+
+  // Buffers of the distinct tensors and running states
+  std::vector<Buffer> buffers;
+
+  // Whether the fused tensors are recomputed
+  bool recompute = false;
+
+  // Largest tensor rank
+  int rank = 0;
+
+ private:
+  uint64_t bit(const DNN::Dimension& dim) const {
+    return uint64_t(1) << index.at(dim);
+  }
+
+  // Index of every dimension
+  std::unordered_map<DNN::Dimension, int, DNN::DimensionHash> index;
+};
+
+// Cost model of one partition of a group
+class IKernel {
+ public:
+  virtual ~IKernel() = default;
+
+  virtual std::unique_ptr<IKernel> clone() const = 0;
+
+  // Set the partition and loop order the next evaluations describe
+  virtual void set(const PartitionVector& p,
+                   const std::vector<DNN::Dimension>& o) = 0;
+
+  // Number of tile steps one core iterates through
+  virtual long long getTileSteps() const = 0;
+
+  // Number of rounds the spatial blocks take on the cores
+  virtual long long getSpatialWaves(int coreNum) const = 0;
+
+  // Compute latency of one core (roofline compute roof), every operator
+  // run once per step of its loops
+  virtual int compute(const Architecture::Mesh& mesh) const = 0;
+
+  // On-chip and off-chip transfer latency of the external tensors, moving
+  // bandwidth-many bytes a cycle
+  virtual std::pair<int, int> traffic(
+      const Architecture::Mesh& mesh) const = 0;
+
+  // Latency of the spatial reductions; the algorithm picked for every
+  // reduction split across cores is appended to `collectives` if given
+  virtual int reduction(
+      const Architecture::Mesh& mesh,
+      std::vector<Collective>* collectives = nullptr) const = 0;
+
+  // Buffer footprint of one core in bytes
+  virtual int footprint(bool doubleBuffering,
+                        Allocation allocation = Allocation::Planned) const = 0;
+};
+
+// Cost kernel over D group dimensions and tensors of rank up to R; 0 stands
+// for a count only known at run time. With both fixed, the per-dimension
+// state lives in std::arrays and every loop over dimensions or tensor ranks
+// has a constant trip count the compiler unrolls.
+template <int D, int R>
+class Kernel : public IKernel {
+ public:
+  explicit Kernel(const std::shared_ptr<const Layout> _layout)
+      : layout(_layout) {
+    resize(spatial);
+    resize(temporal);
+    resize(sharing);
+    resize(tile);
+    resize(order);
+
+    // Padding entries point past the dimensions, at a unit tile
+    for (const auto& access : layout->accesses) {
+      Dims dims{};
+      if constexpr (R == 0) dims.resize(layout->rank);
+      std::fill(dims.begin(), dims.end(), dimNum());
+      std::copy(access.dims.begin(), access.dims.end(), dims.begin());
+      tensorDims.push_back(dims);
+    }
+    tile[dimNum()] = 1;
+  }
+
+  std::unique_ptr<IKernel> clone() const override {
+    return std::make_unique<Kernel>(*this);
+  }
+
+  void set(const PartitionVector& p,
+           const std::vector<DNN::Dimension>& o) override {
+    for (int i = 0; i < dimNum(); i++) {
+      auto [s, t, h] = p.at(layout->dims[i]);
+
+      // Resident dimensions stay whole whatever the factors
+      if (layout->residentMask >> i & 1) s = t = h = 1;
+
+      spatial[i] = s;
+      temporal[i] = t;
+      sharing[i] = h;
+      tile[i] = layout->sizes[i] / (s * t * h);
+    }
+
+    for (int j = 0; j < dimNum(); j++) order[j] = layout->getIndex(o[j]);
+  }
+
+  long long getTileSteps() const override {
+    long long steps = 1;
+    for (int i = 0; i < dimNum(); i++) steps *= temporal[i] * sharing[i];
+    return steps;
+  }
+
+  long long getSpatialWaves(int coreNum) const override {
+    long long blocks = 1;
+    for (int i = 0; i < dimNum(); i++) blocks *= spatial[i];
+    return (blocks + coreNum - 1) / coreNum;
+  }
+
+  int compute(const Architecture::Mesh& mesh) const override {
+    long long macs = 0;
+
+    for (size_t op = 0; op < layout->operatorMasks.size(); op++) {
+      // Operations of one tile of the operator, once per run
+      auto mask = layout->operatorMasks[op];
+      long long tile_macs = layout->operatorWork[op];
+      for (int i = 0; i < dimNum(); i++)
+        if (mask >> i & 1) tile_macs *= std::max(1, tile[i]);
+      macs += tile_macs * getSteps(layout->operatorSteps[op]);
+    }
+
+    for (const auto& rescale : layout->rescales)
+      macs += 1LL * Layout::RESCALE_WORK * getTileSize(rescale.access) *
+              getSteps(layout->operatorSteps[rescale.op]);
+
+    long long cycles = macs / mesh.computeThroughput;
+    return static_cast<int>(
+        std::min<long long>(cycles, std::numeric_limits<int>::max()));
+  }
+
+  std::pair<int, int> traffic(const Architecture::Mesh& mesh) const override {
+    long long onchip_cost = 0;
+    long long offchip_cost = 0;
+
+    for (size_t a = 0; a < layout->accesses.size(); a++) {
+      const auto& access = layout->accesses[a];
+      if (access.fused) continue;
+
+      long long onchip_traffic = getTileSize(a) * access.bytes;
+      long long offchip_traffic = onchip_traffic;
+
+      // From the innermost loop over the tensor outwards
+      bool access_tensor = false;
+      for (int j = 0; j < dimNum(); j++) {
+        int d = order[j];
+        if (access.mask >> d & 1) access_tensor = true;
+        if (!access_tensor) continue;
+
+        // Loops that do not re-run the operator leave its tiles in place
+        if (!(access.steps >> d & 1)) continue;
+
+        onchip_traffic *= 1LL * temporal[d] * (sharing[d] - 1);
+        offchip_traffic *= temporal[d];
+      }
+
+      // A split axis is swept once per pass
+      if (access.axis >= 0 && tile[access.axis] < layout->sizes[access.axis]) {
+        onchip_traffic *= access.passes;
+        offchip_traffic *= access.passes;
+      }
+
+      onchip_cost += onchip_traffic / mesh.onchipBandwidth;
+      offchip_cost += offchip_traffic / mesh.offchipBandwidth;
+    }
+
+    auto clamp = [](long long cost) {
+      return static_cast<int>(
+          std::min<long long>(cost, std::numeric_limits<int>::max()));
+    };
+    return {clamp(onchip_cost), clamp(offchip_cost)};
+  }
+
+  int reduction(const Architecture::Mesh& mesh,
+                std::vector<Collective>* collectives) const override {
+    long long cost = 0;
+
+    for (const auto& reduction : layout->reductions) {
+      // Only dimensions partitioned spatially are reduced across cores, and
+      // the cores holding partial sums of one tile reduce them together
+      long long participants = 1;
+      for (int i = 0; i < dimNum(); i++)
+        if (reduction.mask >> i & 1) participants *= spatial[i];
+      participants = std::min<long long>(participants, mesh.coreNum);
+      if (participants == 1) continue;
+
+      // Every output tile of a core is reduced once, by the cheapest
+      // algorithm for its size
+      const auto& access = layout->accesses[reduction.access];
+      long long bytes =
+          1LL * getTileSize(reduction.access) * access.bufferBytes;
+      auto [collective, cycles] = pickCollective(
+          bytes, participants, reduction.allReduce, mesh);
+      cost += cycles * getSteps(access.mask & access.steps);
+      if (collectives) collectives->push_back(collective);
+    }
+
+    return static_cast<int>(
+        std::min<long long>(cost, std::numeric_limits<int>::max()));
+  }
+
+  int footprint(bool doubleBuffering, Allocation allocation) const override {
+    // Innermost loop that advances: tiles it does not index carry over to
+    // the next tile step
+    int innermost = -1;
+    for (int j = 0; j < dimNum() && innermost < 0; j++)
+      if (temporal[order[j]] * sharing[order[j]] > 1) innermost = order[j];
+
+    int steps = layout->operatorMasks.size();
+    blocks.clear();
+    for (const auto& buffer : layout->buffers) {
+      Block block{Layout::STATE_BYTES, 0, steps - 1};
+
+      // Running states live through every step
+      if (buffer.access < 0) {
+        auto row = layout->states[buffer.state];
+        for (int i = 0; i < dimNum(); i++)
+          if (row >> i & 1) block.size *= tile[i];
+        blocks.push_back(block);
+        continue;
+      }
+
+      // Fused tensors are not staged; a second buffer receives the next tile
+      // of the others when double buffering
+      const auto& access = layout->accesses[buffer.access];
+      block.size = 1LL * getTileSize(buffer.access) * access.bufferBytes;
+      long long held = access.fused ? getHeldTiles(access) : 1;
+      bool prefetched = doubleBuffering && !access.fused;
+      block.size *= prefetched ? 2 : held;
+
+      // A tile dies after its last operator unless a later step reuses it
+      bool carried = innermost >= 0 && !(access.mask >> innermost & 1) &&
+                     !(access.fused && layout->recompute);
+      if (!carried && !prefetched && held == 1) {
+        block.first = buffer.first;
+        block.last = buffer.last;
+      }
+      blocks.push_back(block);
+    }
+
+    long long volume = 0;
+    if (allocation == Allocation::Planned)
+      volume = planOffsets(blocks, scratch);
+    else if (allocation == Allocation::Live)
+      volume = getLivePeak(blocks, steps);
+    else
+      for (const auto& block : blocks) volume += block.size;
+
+    return static_cast<int>(
+        std::min<long long>(volume, std::numeric_limits<int>::max()));
+  }
+
+ private:
+  // Per-dimension values with a padding slot, and dimensions of a tensor
+  using Values =
+      std::conditional_t<D == 0, std::vector<int>, std::array<int, D + 1>>;
+  using Dims = std::conditional_t<R == 0, std::vector<int>, std::array<int, R>>;
+
+  void resize(Values& values) const {
+    if constexpr (D == 0) values.resize(layout->dims.size() + 1);
+  }
+
+  // Number of dimensions, a constant when specialised
+  int dimNum() const noexcept {
+    if constexpr (D == 0) return layout->dims.size();
+    return D;
+  }
+
+  // Number of runs over the loops of a mask
+  long long getSteps(uint64_t mask) const noexcept {
+    long long steps = 1;
+    for (int i = 0; i < dimNum(); i++)
+      if (mask >> i & 1) steps *= temporal[i] * sharing[i];
+    return steps;
+  }
+
+  // Tiles a stored fused tensor holds: those of its loops nested in the
+  // outermost loop its users revisit it across. A recomputed one holds one.
+  long long getHeldTiles(const Layout::Access& access) const noexcept {
+    long long held = 1;
+    long long inner = 1;
+    for (int j = 0; j < dimNum(); j++) {
+      int d = order[j];
+      int trips = temporal[d] * sharing[d];
+      if (access.mask >> d & 1)
+        inner *= trips;
+      else if (access.hold >> d & 1 && trips > 1)
+        held = inner;
+    }
+    return held;
+  }
+
+  // Tile size of a tensor of an operator
+  long long getTileSize(size_t a) const noexcept {
+    long long tile_size = 1;
+    for (auto d : tensorDims[a]) tile_size *= tile[d];
+    return tile_size;
+  }
+
+  std::shared_ptr<const Layout> layout;
+
+  // Dimensions of every tensor, padded to the rank
+  std::vector<Dims> tensorDims;
+
+  // Factors and tile size of every dimension
+  Values spatial{};
+  Values temporal{};
+  Values sharing{};
+  Values tile{};
+
+  // Dimension indices from the innermost loop to the outermost
+  Values order{};
+
+  // Buffers of the last footprint and the order the planner placed them
+  mutable std::vector<Block> blocks;
+  mutable std::vector<int> scratch;
+};
+
+// Smallest and largest specialised dimension counts and tensor ranks
+constexpr int MIN_DIMS = 2;
+constexpr int MAX_DIMS = 8;
+constexpr int MIN_RANK = 1;
+constexpr int MAX_RANK = 4;
+
+// Pick the kernel specialised to the rank of the group's tensors
+template <int D, int R = MIN_RANK>
+std::unique_ptr<IKernel> specialiseRank(
+    const std::shared_ptr<const Layout>& layout) {
+  if constexpr (R > MAX_RANK) {
+    return std::make_unique<Kernel<D, 0>>(layout);
+  } else {
+    if (layout->rank != R) return specialiseRank<D, R + 1>(layout);
+    return std::make_unique<Kernel<D, R>>(layout);
+  }
+}
+
+// Pick the kernel specialised to the group, or the generic one
+template <int D = MIN_DIMS>
+std::unique_ptr<IKernel> specialise(
+    const std::shared_ptr<const Layout>& layout) {
+  if constexpr (D > MAX_DIMS) {
+    return std::make_unique<Kernel<0, 0>>(layout);
+  } else {
+    if (static_cast<int>(layout->dims.size()) != D)
+      return specialise<D + 1>(layout);
+    return specialiseRank<D>(layout);
+  }
+}
+}  // namespace Cost
+
+#endif
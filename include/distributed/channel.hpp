@@ -0,0 +1,155 @@
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Distributed {
+// Framed message stream over a connected socket. Frames are a type and a
+// payload size followed by the payload, so the same channel works over Unix
+// sockets today and TCP sockets once workers live on other machines.
+class Channel {
+ public:
+  explicit Channel(int _fd) : fd(_fd) {}
+
+  ~Channel() {
+    if (fd >= 0) close(fd);
+  }
+
+  Channel(const Channel&) = delete;
+  Channel& operator=(const Channel&) = delete;
+
+  // Connect to a listening Unix socket
+  static std::unique_ptr<Channel> connect(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return nullptr;
+
+    auto address = makeAddress(path);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address),
+                  sizeof(address)) < 0) {
+      close(fd);
+      return nullptr;
+    }
+    return std::make_unique<Channel>(fd);
+  }
+
+  // Send one message
+  bool send(uint32_t type, const std::vector<char>& payload) noexcept {
+    uint32_t header[2] = {type, static_cast<uint32_t>(payload.size())};
+    return writeAll(header, sizeof(header)) &&
+           writeAll(payload.data(), payload.size());
+  }
+
+  // Receive one message, blocking
+  bool receive(uint32_t& type, std::vector<char>& payload) {
+    uint32_t header[2];
+    if (!readAll(header, sizeof(header))) return false;
+
+    type = header[0];
+    payload.resize(header[1]);
+    return readAll(payload.data(), payload.size());
+  }
+
+  // Check if a message can be received within the timeout
+  bool ready(int timeoutMs = 0) const noexcept {
+    pollfd p{fd, POLLIN, 0};
+    return poll(&p, 1, timeoutMs) > 0;
+  }
+
+  int getFd() const noexcept { return fd; }
+
+  static sockaddr_un makeAddress(const std::string& path) noexcept {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+  }
+
+ private:
+  bool writeAll(const void* data, size_t size) noexcept {
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+      auto n = ::send(fd, bytes, size, MSG_NOSIGNAL);
+      if (n <= 0) return false;
+      bytes += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  bool readAll(void* data, size_t size) noexcept {
+    auto bytes = static_cast<char*>(data);
+    while (size > 0) {
+      auto n = ::recv(fd, bytes, size, 0);
+      if (n <= 0) return false;
+      bytes += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  // Socket
+  int fd;
+};
+
+// Listening Unix socket accepting worker connections
+class Listener {
+ public:
+  explicit Listener(const std::string& _path) : path(_path) {
+    unlink(path.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    auto address = Channel::makeAddress(path);
+    if (fd < 0 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+      if (fd >= 0) close(fd);
+      fd = -1;
+    }
+  }
+
+  ~Listener() {
+    if (fd < 0) return;
+    close(fd);
+    unlink(path.c_str());
+  }
+
+  Listener(const Listener&) = delete;
+  Listener& operator=(const Listener&) = delete;
+
+  // Check if the socket is listening
+  bool isOpen() const noexcept { return fd >= 0; }
+
+  // Accept the next connection, blocking
+  std::unique_ptr<Channel> accept() {
+    int client = ::accept(fd, nullptr, nullptr);
+    if (client < 0) return nullptr;
+    return std::make_unique<Channel>(client);
+  }
+
+  // Check if a connection can be accepted within the timeout
+  bool ready(int timeoutMs = 0) const noexcept {
+    pollfd p{fd, POLLIN, 0};
+    return poll(&p, 1, timeoutMs) > 0;
+  }
+
+  const auto& getPath() const noexcept { return path; }
+
+ private:
+  // Socket path
+  std::string path;
+
+  // Socket
+  int fd = -1;
+};
+}  // namespace Distributed
+
+#endif
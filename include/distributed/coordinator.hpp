@@ -0,0 +1,411 @@
+#ifndef COORDINATOR_HPP
+#define COORDINATOR_HPP
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+
+#include "distributed/channel.hpp"
+#include "fusion.hpp"
+#include "serialize.hpp"
+
+namespace Distributed {
+enum MessageType : uint32_t {
+  // Coordinator to worker: fusion candidate to evaluate
+  JOB,
+  // Worker to coordinator: candidate cost and freshly mapped groups
+  RESULT,
+  // Coordinator to worker: best total cost so far
+  INCUMBENT,
+  // Coordinator to worker: cost of a group mapped elsewhere
+  GROUP_RESULT,
+  // Coordinator to worker: no more jobs
+  STOP
+};
+
+struct CoordinatorStatistics {
+  // Evaluated fusion candidates
+  int candidates = 0;
+
+  // Candidates abandoned once they exceeded the incumbent
+  int pruned = 0;
+
+  // Groups reused from the shared cache instead of mapped
+  int cacheHits = 0;
+
+  // Distinct groups in the shared cache
+  int cachedGroups = 0;
+};
+
+// Evaluates fusion candidates sent by a coordinator. Groups already mapped by
+// any worker are taken from the pushed cache, and a candidate is abandoned as
+// soon as its partial cost plus the lower bounds of its remaining groups
+// exceeds the pushed incumbent.
+class Worker {
+ public:
+  Worker(const std::shared_ptr<FusionSpace> _fusionSpace,
+         const std::shared_ptr<Architecture::Mesh> _mesh,
+         std::unique_ptr<Channel> _channel)
+      : fusionSpace(_fusionSpace), mesh(_mesh), channel(std::move(_channel)) {}
+
+  // Serve jobs until the coordinator stops the worker
+  void run() {
+    uint32_t type;
+    std::vector<char> payload;
+
+    while (!stopping && channel->receive(type, payload)) {
+      handle(type, payload);
+    }
+  }
+
+ private:
+  void handle(uint32_t type, const std::vector<char>& payload) {
+    BinaryReader reader(payload);
+
+    switch (type) {
+      case JOB:
+        evaluate(reader.readBits());
+        break;
+      case INCUMBENT:
+        incumbent = reader.read<int>();
+        break;
+      case GROUP_RESULT: {
+        auto key = reader.readString();
+        cache[key] = reader.read<int>();
+        break;
+      }
+      case STOP:
+        stopping = true;
+        break;
+    }
+  }
+
+  // Apply the updates the coordinator pushed meanwhile
+  void drain() {
+    uint32_t type;
+    std::vector<char> payload;
+
+    while (!stopping && channel->ready() && channel->receive(type, payload)) {
+      handle(type, payload);
+    }
+  }
+
+  void evaluate(const std::vector<bool>& fusion_bit) {
+    auto groups = fusionSpace->generateCandidateGroups(fusion_bit);
+
+    long long total = 0;
+    int hits = 0;
+    bool pruned = false;
+    std::vector<std::pair<std::string, int>> fresh;
+
+    // Lower bounds of the groups not mapped yet, cached groups exact
+    std::vector<int> bounds(groups.size());
+    long long remaining = 0;
+    for (int g = 0; g < static_cast<int>(groups.size()); g++) {
+      auto it = cache.find(groups[g]->getKey());
+      bounds[g] = it != cache.end() ? it->second
+                                    : fusionSpace->boundGroup(groups[g], mesh);
+      remaining += bounds[g];
+    }
+
+    for (int g = 0; g < static_cast<int>(groups.size()); g++) {
+      drain();
+      if (total + remaining > incumbent) {
+        pruned = true;
+        break;
+      }
+      remaining -= bounds[g];
+
+      auto key = groups[g]->getKey();
+      auto it = cache.find(key);
+      if (it != cache.end()) {
+        total += it->second;
+        hits++;
+        continue;
+      }
+
+      // Seeded by the key, so a cached cost is the one any candidate would
+      // have mapped for itself
+      auto group_seed = fusionSpace->getGroupSeed(*groups[g]);
+      int cost = fusionSpace->mapGroup(groups[g], mesh, group_seed);
+      cache[key] = cost;
+      fresh.emplace_back(key, cost);
+      total += cost;
+    }
+
+    BinaryWriter writer;
+    writer.writeBits(fusion_bit);
+    writer.write<int>(
+        std::min<long long>(total, std::numeric_limits<int>::max()));
+    writer.write<uint8_t>(pruned);
+    writer.write<int>(hits);
+    writer.write<uint32_t>(fresh.size());
+    for (const auto& [key, cost] : fresh) {
+      writer.writeString(key);
+      writer.write<int>(cost);
+    }
+    channel->send(RESULT, writer.getBuffer());
+  }
+
+  // Fusion space of the shared graph
+  std::shared_ptr<FusionSpace> fusionSpace;
+
+  // Mesh
+  std::shared_ptr<Architecture::Mesh> mesh;
+
+  // Connection to the coordinator
+  std::unique_ptr<Channel> channel;
+
+  // Best total cost known to the coordinator
+  int incumbent = std::numeric_limits<int>::max();
+
+  // Group costs by group key
+  std::unordered_map<std::string, int> cache;
+
+  // Whether the coordinator asked to stop
+  bool stopping = false;
+};
+
+// Shards the fusion space over worker processes connected through a Unix
+// socket. Each worker holds one job at a time; results feed the incumbent
+// and the group cache, which are pushed to every worker.
+class Coordinator {
+ public:
+  explicit Coordinator(const std::string& path) : listener(path) {}
+
+  ~Coordinator() {
+    for (auto pid : children) waitpid(pid, nullptr, 0);
+  }
+
+  // Check if the coordinator socket is listening
+  bool isOpen() const noexcept { return listener.isOpen(); }
+
+  // Fork local worker processes that connect back to the coordinator and
+  // return how many were started
+  int spawnLocalWorkers(
+      int n, const std::function<void(std::unique_ptr<Channel>)>& workerMain) {
+    std::cout.flush();
+
+    int spawned = 0;
+    for (int i = 0; i < n; i++) {
+      auto pid = fork();
+      if (pid == 0) {
+        auto channel = Channel::connect(listener.getPath());
+        if (channel) workerMain(std::move(channel));
+        std::cout.flush();
+        _exit(0);
+      }
+      if (pid < 0) continue;
+      children.push_back(pid);
+      spawned++;
+    }
+    return spawned;
+  }
+
+  // Set how long run() waits for the workers to connect
+  void setAcceptTimeout(std::chrono::milliseconds _acceptTimeout) noexcept {
+    acceptTimeout = _acceptTimeout;
+  }
+
+  // Wait for the workers and evaluate every fusion candidate of the space.
+  // Local workers that exit before connecting are not waited for, and the
+  // search starts with the workers connected when the timeout expires.
+  std::vector<bool> run(int tensorNum, int workerNum) {
+    auto deadline = std::chrono::steady_clock::now() + acceptTimeout;
+    while (static_cast<int>(channels.size()) < workerNum &&
+           std::chrono::steady_clock::now() < deadline) {
+      if (!listener.ready(100)) {
+        workerNum -= reap();
+        continue;
+      }
+      auto channel = listener.accept();
+      if (channel) channels.push_back(std::move(channel));
+    }
+
+    long long total = 1LL << tensorNum;
+    long long next = 0;
+
+    // Candidate each worker holds, -1 if idle, and candidates of workers
+    // that went away, handed out again before new ones
+    std::vector<long long> jobs(channels.size(), -1);
+    std::deque<long long> requeued;
+    int busy = 0;
+
+    std::vector<pollfd> fds;
+    for (const auto& channel : channels)
+      fds.push_back({channel->getFd(), POLLIN, 0});
+
+    // A worker that went away hands its candidate back
+    auto drop = [&](int w) {
+      fds[w].fd = -1;
+      if (jobs[w] < 0) return;
+      requeued.push_back(jobs[w]);
+      jobs[w] = -1;
+      busy--;
+    };
+
+    auto dispatch = [&](int w) {
+      if (fds[w].fd < 0 || jobs[w] >= 0) return;
+      if (requeued.empty() && next >= total) return;
+
+      long long candidate = next;
+      if (!requeued.empty()) {
+        candidate = requeued.front();
+        requeued.pop_front();
+      } else {
+        next++;
+      }
+
+      std::vector<bool> fusion_bit(tensorNum);
+      for (int j = 0; j < tensorNum; j++) fusion_bit[j] = (candidate >> j) & 1;
+
+      BinaryWriter writer;
+      writer.writeBits(fusion_bit);
+      jobs[w] = candidate;
+      busy++;
+      if (!channels[w]->send(JOB, writer.getBuffer())) drop(w);
+    };
+
+    auto dispatchAll = [&]() {
+      for (int w = 0; w < static_cast<int>(channels.size()); w++) dispatch(w);
+    };
+    dispatchAll();
+
+    uint32_t type;
+    std::vector<char> payload;
+
+    while (busy > 0) {
+      if (poll(fds.data(), fds.size(), -1) <= 0) break;
+
+      for (int w = 0; w < static_cast<int>(channels.size()); w++) {
+        if (fds[w].fd < 0) continue;
+        if (!(fds[w].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        if (!channels[w]->receive(type, payload)) {
+          drop(w);
+          continue;
+        }
+        if (type != RESULT || jobs[w] < 0) continue;
+
+        jobs[w] = -1;
+        busy--;
+        collect(payload, w);
+        dispatch(w);
+      }
+
+      // Idle workers pick up the candidates of the ones that went away
+      if (!requeued.empty()) dispatchAll();
+    }
+
+    for (int w = 0; w < static_cast<int>(channels.size()); w++)
+      if (fds[w].fd >= 0) channels[w]->send(STOP, {});
+
+    // Workers that connected too late are stopped too
+    while (listener.ready())
+      if (auto channel = listener.accept()) channel->send(STOP, {});
+    return best;
+  }
+
+  // Get the best total cost
+  auto getBestCost() const noexcept { return bestCost; }
+
+  // Get the statistics of the run
+  auto getStatistics() const noexcept { return statistics; }
+
+ private:
+  // Forget the local workers that exited and return how many
+  int reap() {
+    int exited = 0;
+    for (auto it = children.begin(); it != children.end();) {
+      if (waitpid(*it, nullptr, WNOHANG) != *it) {
+        ++it;
+        continue;
+      }
+      it = children.erase(it);
+      exited++;
+    }
+    return exited;
+  }
+
+  void collect(const std::vector<char>& payload, int from) {
+    BinaryReader reader(payload);
+    auto fusion_bit = reader.readBits();
+    int cost = reader.read<int>();
+    bool pruned = reader.read<uint8_t>();
+    statistics.cacheHits += reader.read<int>();
+
+    // Share the freshly mapped groups with the other workers
+    auto fresh = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < fresh && reader.isGood(); i++) {
+      auto key = reader.readString();
+      int group_cost = reader.read<int>();
+      if (!cache.emplace(key, group_cost).second) continue;
+
+      BinaryWriter writer;
+      writer.writeString(key);
+      writer.write<int>(group_cost);
+      broadcast(GROUP_RESULT, writer.getBuffer(), from);
+    }
+
+    statistics.candidates++;
+    statistics.cachedGroups = cache.size();
+    if (pruned) {
+      statistics.pruned++;
+      return;
+    }
+
+    // Ties go to the candidate with the lower index
+    if (cost > bestCost) return;
+    if (cost == bestCost && !best.empty() && index(fusion_bit) > index(best))
+      return;
+
+    bool improved = cost < bestCost;
+    bestCost = cost;
+    best = fusion_bit;
+
+    if (!improved) return;
+    BinaryWriter writer;
+    writer.write<int>(bestCost);
+    broadcast(INCUMBENT, writer.getBuffer(), -1);
+  }
+
+  void broadcast(uint32_t type, const std::vector<char>& payload, int skip) {
+    for (int w = 0; w < static_cast<int>(channels.size()); w++)
+      if (w != skip) channels[w]->send(type, payload);
+  }
+
+  static long long index(const std::vector<bool>& fusion_bit) noexcept {
+    long long i = 0;
+    for (int j = 0; j < static_cast<int>(fusion_bit.size()); j++)
+      i |= static_cast<long long>(fusion_bit[j]) << j;
+    return i;
+  }
+
+  // Socket the workers connect to
+  Listener listener;
+
+  // Forked local workers
+  std::vector<pid_t> children;
+
+  // Longest wait for the workers to connect
+  std::chrono::milliseconds acceptTimeout{30000};
+
+  // Connected workers
+  std::vector<std::unique_ptr<Channel>> channels;
+
+  // Group costs by group key
+  std::unordered_map<std::string, int> cache;
+
+  // Best fusion candidate and its cost
+  std::vector<bool> best;
+  int bestCost = std::numeric_limits<int>::max();
+
+  // Statistics of the run
+  CoordinatorStatistics statistics;
+};
+}  // namespace Distributed
+
+#endif
@@ -0,0 +1,530 @@
+#ifndef SERVICE_HPP
+#define SERVICE_HPP
+
+#include <future>
+#include <list>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "distributed/channel.hpp"
+#include "fusion.hpp"
+#include "serialize.hpp"
+
+namespace Distributed {
+enum ServiceMessageType : uint32_t {
+  // Client to service: graph, mesh and seed to decide
+  QUERY = 16,
+  // Service to client: fusion and mapping decisions
+  DECISION,
+  // Service to client: the query could not be decoded
+  REJECTED,
+  // Client to service: stop serving
+  SHUTDOWN
+};
+
+// Bounded map evicting the least recently used entry, safe to share between
+// threads
+template <typename Key, typename Value>
+class LruCache {
+ public:
+  explicit LruCache(size_t _capacity)
+      : capacity(std::max<size_t>(1, _capacity)) {}
+
+  // Find a value and mark it as recently used
+  std::optional<Value> get(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+      misses++;
+      return std::nullopt;
+    }
+
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+
+  // Insert or replace a value, evicting the least recently used beyond the
+  // capacity
+  void put(const Key& key, Value value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      it->second->second = std::move(value);
+      entries.splice(entries.begin(), entries, it->second);
+      return;
+    }
+
+    entries.emplace_front(key, std::move(value));
+    index.emplace(key, entries.begin());
+    if (entries.size() <= capacity) return;
+
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+  // Get the lookups that found and missed a value
+  long long getHits() const noexcept { return hits; }
+  long long getMisses() const noexcept { return misses; }
+
+ private:
+  // Maximal number of entries
+  size_t capacity;
+
+  // Entries from the most to the least recently used
+  std::list<std::pair<Key, Value>> entries;
+
+  // Entry of every key
+  std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator>
+      index;
+
+  // Guard of the entries
+  mutable std::mutex mutex;
+
+  std::atomic<long long> hits{0};
+  std::atomic<long long> misses{0};
+};
+
+// Best mapping of one group, by dimension name
+struct GroupDecision {
+  // Operators of the group
+  std::string signature;
+
+  // Best cost found
+  int cost = std::numeric_limits<int>::max();
+
+  // Spatial, temporal and sharing factor of every dimension
+  std::vector<std::tuple<std::string, int, int, int>> factors;
+
+  // Loop order from the innermost dimension outwards
+  std::vector<std::string> order;
+};
+
+// Answer to a query
+struct Decision {
+  // Fusion bits of the best candidate, in the graph's fusion tensor order
+  std::vector<bool> fusion;
+
+  // Total cost of its groups
+  int cost = std::numeric_limits<int>::max();
+
+  // Mapping of each group
+  std::vector<GroupDecision> groups;
+};
+
+// Encode a query: the graph operators with their tensors, the mesh and the
+// seed of the searches
+inline void encodeQuery(BinaryWriter& writer, const DNN::DAG& graph,
+                        const Architecture::Mesh& mesh, uint64_t seed) {
+  auto writeTensors = [&](const std::vector<DNN::Tensor>& tensors) {
+    writer.write<uint32_t>(tensors.size());
+    for (const auto& tensor : tensors) {
+      writer.writeString(tensor.getName());
+      writer.write(tensor.getType());
+      writer.write<uint32_t>(tensor.getDimensions().size());
+      for (const auto& dim : tensor.getDimensions()) {
+        writer.writeString(dim.getName());
+        writer.write(dim.getSize());
+      }
+    }
+  };
+
+  writer.write<uint32_t>(graph.getOperators().size());
+  for (const auto& op : graph.getOperators()) {
+    writer.writeString(op.getName());
+    writer.write(op.getKind());
+    writer.write<uint8_t>(op.getAxis().has_value());
+    if (op.getAxis()) {
+      writer.writeString(op.getAxis()->getName());
+      writer.write(op.getAxis()->getSize());
+    }
+    writeTensors(op.getInputs());
+    writeTensors(op.getOutputs());
+  }
+  writer.write(mesh);
+  writer.write(seed);
+}
+
+// Decode a query encoded by encodeQuery(); the graph is nullptr if it is
+// damaged
+inline std::shared_ptr<const DNN::DAG> decodeQuery(BinaryReader& reader,
+                                                   Architecture::Mesh& mesh,
+                                                   uint64_t& seed) {
+  auto readTensors = [&] {
+    std::vector<DNN::Tensor> tensors;
+    auto num = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < num && reader.isGood(); i++) {
+      auto name = reader.readString();
+      auto type = reader.read<DNN::DataType>();
+      std::vector<DNN::Dimension> dims;
+      auto rank = reader.read<uint32_t>();
+      for (uint32_t j = 0; j < rank && reader.isGood(); j++) {
+        auto dim = reader.readString();
+        dims.emplace_back(dim, reader.read<int>());
+      }
+      tensors.emplace_back(name, dims, type);
+    }
+    return tensors;
+  };
+
+  std::vector<DNN::Operator> operators;
+  auto num = reader.read<uint32_t>();
+  for (uint32_t i = 0; i < num && reader.isGood(); i++) {
+    auto name = reader.readString();
+    auto kind = reader.read<DNN::OperatorKind>();
+    std::optional<DNN::Dimension> axis;
+    if (reader.read<uint8_t>()) {
+      auto dim = reader.readString();
+      axis.emplace(dim, reader.read<int>());
+    }
+    auto inputs = readTensors();
+    auto outputs = readTensors();
+    operators.emplace_back(name, kind, inputs, outputs, axis);
+  }
+  mesh = reader.read<Architecture::Mesh>();
+  seed = reader.read<uint64_t>();
+
+  if (!reader.isGood() || operators.empty()) return nullptr;
+  if (mesh.coreNum < 1 || mesh.footprintPerCore < 1 ||
+      mesh.onchipBandwidth < 1 || mesh.offchipBandwidth < 1 ||
+      mesh.computeThroughput < 1 || mesh.meshWidth < 1 ||
+      mesh.linkLatency < 0)
+    return nullptr;
+
+  // Groups index their dimensions in 64-bit masks
+  std::unordered_set<std::string> names;
+  for (const auto& op : operators) {
+    if (op.getKind() > DNN::OperatorKind::LayerNorm) return nullptr;
+    for (const auto& tensor : op.getTensors())
+      if (tensor.getType() > DNN::DataType::INT32) return nullptr;
+
+    const auto& dims = op.getDimensions();
+    for (const auto& dim : dims) {
+      if (dim.getSize() < 1) return nullptr;
+      names.insert(dim.getName());
+    }
+    if (op.getAxis() && !dims.count(*op.getAxis())) return nullptr;
+  }
+  if (names.size() > 64) return nullptr;
+
+  return std::make_shared<const DNN::DAG>(operators);
+}
+
+inline void encodeDecision(BinaryWriter& writer, const Decision& decision) {
+  writer.writeBits(decision.fusion);
+  writer.write(decision.cost);
+  writer.write<uint32_t>(decision.groups.size());
+  for (const auto& group : decision.groups) {
+    writer.writeString(group.signature);
+    writer.write(group.cost);
+    writer.write<uint32_t>(group.factors.size());
+    for (const auto& [name, spatial, temporal, sharing] : group.factors) {
+      writer.writeString(name);
+      writer.write(spatial);
+      writer.write(temporal);
+      writer.write(sharing);
+    }
+    writer.write<uint32_t>(group.order.size());
+    for (const auto& name : group.order) writer.writeString(name);
+  }
+}
+
+inline Decision decodeDecision(BinaryReader& reader) {
+  Decision decision;
+  decision.fusion = reader.readBits();
+  decision.cost = reader.read<int>();
+
+  auto num = reader.read<uint32_t>();
+  for (uint32_t i = 0; i < num && reader.isGood(); i++) {
+    GroupDecision group;
+    group.signature = reader.readString();
+    group.cost = reader.read<int>();
+
+    auto dims = reader.read<uint32_t>();
+    for (uint32_t j = 0; j < dims && reader.isGood(); j++) {
+      auto name = reader.readString();
+      int spatial = reader.read<int>();
+      int temporal = reader.read<int>();
+      int sharing = reader.read<int>();
+      group.factors.emplace_back(name, spatial, temporal, sharing);
+    }
+
+    auto order = reader.read<uint32_t>();
+    for (uint32_t j = 0; j < order && reader.isGood(); j++)
+      group.order.push_back(reader.readString());
+    decision.groups.push_back(group);
+  }
+  return decision;
+}
+
+struct ServiceStatistics {
+  // Answered queries
+  long long queries = 0;
+
+  // Queries answered from the decision cache
+  long long cachedQueries = 0;
+
+  // Groups reused from the group cache instead of mapped
+  long long cachedGroups = 0;
+
+  // Groups mapped
+  long long mappedGroups = 0;
+};
+
+// Long-running mapping service on a Unix socket. Every connection gets a
+// thread that only waits; queries run as tasks of one shared scheduler, so
+// concurrent clients share its workers. Decisions are cached by the exact
+// query, and group mappings by the group's operators, tensor shapes, mesh
+// and seed, both in bounded LRU caches that outlive the requests.
+class Service {
+ public:
+  Service(const std::string& path, size_t capacity,
+          const std::shared_ptr<Runtime::Scheduler> _scheduler)
+      : listener(path),
+        decisions(capacity),
+        groups(capacity),
+        scheduler(_scheduler) {}
+
+  ~Service() {
+    stopping = true;
+    for (auto& connection : connections) connection.thread.join();
+  }
+
+  // Check if the service socket is listening
+  bool isOpen() const noexcept { return listener.isOpen(); }
+
+  // Serve connections until a client sends SHUTDOWN
+  void run() {
+    while (!stopping) {
+      reap();
+      if (!listener.ready(100)) continue;
+
+      auto channel = listener.accept();
+      if (!channel) continue;
+
+      auto done = std::make_shared<std::atomic<bool>>(false);
+      std::thread thread(
+          [this, done, channel = std::shared_ptr<Channel>(std::move(channel))] {
+            serve(*channel);
+            *done = true;
+          });
+      connections.push_back({std::move(thread), done});
+    }
+  }
+
+  // Find the decision of a query asked before
+  std::optional<std::vector<char>> lookup(const std::vector<char>& query) {
+    auto cached = decisions.get(std::string(query.begin(), query.end()));
+    if (cached) cachedQueries++;
+    return cached;
+  }
+
+  // Answer a query and cache its decision; the payload is empty if the
+  // query is damaged
+  std::vector<char> answer(const std::vector<char>& query) {
+    Architecture::Mesh mesh;
+    uint64_t seed = 0;
+    BinaryReader reader(query);
+    auto graph = decodeQuery(reader, mesh, seed);
+
+    // Candidates are enumerated, so the fusion space must stay small
+    if (!graph || graph->getNumPotentialFusionTensors() > MAX_FUSION_TENSORS)
+      return {};
+
+    BinaryWriter writer;
+    encodeDecision(writer, decide(graph, mesh, seed));
+    decisions.put(std::string(query.begin(), query.end()), writer.getBuffer());
+    return writer.getBuffer();
+  }
+
+  ServiceStatistics getStatistics() const noexcept {
+    ServiceStatistics statistics;
+    statistics.queries = queries;
+    statistics.cachedQueries = cachedQueries;
+    statistics.cachedGroups = cachedGroups;
+    statistics.mappedGroups = mappedGroups;
+    return statistics;
+  }
+
+  // Largest number of fusion tensors of a query graph
+  static constexpr int MAX_FUSION_TENSORS = 16;
+
+ private:
+  // Join the threads of the clients that went away
+  void reap() {
+    for (auto it = connections.begin(); it != connections.end();) {
+      if (!*it->done) {
+        ++it;
+        continue;
+      }
+      it->thread.join();
+      it = connections.erase(it);
+    }
+  }
+
+  // Answer the queries of one client until it disconnects
+  void serve(Channel& channel) {
+    uint32_t type;
+    std::vector<char> payload;
+
+    while (!stopping) {
+      if (!channel.ready(100)) continue;
+      if (!channel.receive(type, payload)) return;
+
+      if (type == SHUTDOWN) {
+        stopping = true;
+        return;
+      }
+      if (type != QUERY) continue;
+
+      // Repeats are answered right away, new queries run on the pool while
+      // this thread only waits
+      std::vector<char> response;
+      if (auto cached = lookup(payload)) {
+        response = std::move(*cached);
+      } else {
+        std::promise<std::vector<char>> promise;
+        auto result = promise.get_future();
+        scheduler->submit([&] {
+          // A query the checks let through must not end the service
+          std::vector<char> decision;
+          try {
+            decision = answer(payload);
+          } catch (...) {
+            decision.clear();
+          }
+          promise.set_value(std::move(decision));
+        });
+        response = result.get();
+      }
+
+      queries++;
+      if (response.empty())
+        channel.send(REJECTED, {});
+      else
+        channel.send(DECISION, response);
+    }
+  }
+
+  // Search every fusion candidate, mapping each group once
+  Decision decide(const std::shared_ptr<const DNN::DAG> graph,
+                  const Architecture::Mesh& mesh, uint64_t seed) {
+    FusionSpace fs(graph, seed);
+    fs.setScheduler(scheduler);
+    auto shared_mesh = std::make_shared<Architecture::Mesh>(mesh);
+
+    auto map = [&](const std::vector<bool>& fusion_bit) {
+      auto candidate_groups = fs.generateCandidateGroups(fusion_bit);
+      std::vector<GroupDecision> decided(candidate_groups.size());
+      Runtime::parallelFor(scheduler, candidate_groups.size(), [&](int g) {
+        decided[g] = mapGroup(candidate_groups[g], shared_mesh, seed);
+      });
+      return decided;
+    };
+
+    auto total = [](const std::vector<GroupDecision>& decided) {
+      long long sum = 0;
+      for (const auto& group : decided) sum += group.cost;
+      return static_cast<int>(
+          std::min<long long>(sum, std::numeric_limits<int>::max()));
+    };
+
+    TraverseSearch ts(scheduler);
+    int tensor_num = graph->getNumPotentialFusionTensors();
+    auto best = ts.search(std::vector<bool>(tensor_num, false),
+                          [&](const std::vector<bool>& fusion_bit) {
+                            return total(map(fusion_bit));
+                          });
+
+    // The groups of the best candidate are cached by now
+    Decision decision;
+    decision.fusion = best;
+    decision.groups = map(best);
+    decision.cost = total(decision.groups);
+    return decision;
+  }
+
+  // Map a group, or take its mapping from the cache
+  GroupDecision mapGroup(const std::shared_ptr<DNN::OperatorGroup> group,
+                         const std::shared_ptr<Architecture::Mesh> mesh,
+                         uint64_t seed) {
+    auto key = getGroupKey(*group, *mesh, seed);
+    if (auto cached = groups.get(key)) {
+      cachedGroups++;
+      return *cached;
+    }
+
+    // Seeded by the key, so a group maps the same in every candidate
+    auto analysis = std::make_shared<PartitionAnalysis>(group, mesh);
+    auto group_seed =
+        Algorithm::Random::derive(seed, std::hash<std::string>()(key));
+    Mapper mapper(analysis, group_seed, scheduler);
+    mapper.search();
+    mappedGroups++;
+
+    GroupDecision decided;
+    decided.signature = group->getSignature();
+    decided.cost = mapper.getBestCost();
+
+    const auto& [p, o] = mapper.getBestMapping();
+    for (const auto& dim : o) {
+      auto [spatial, temporal, sharing] = p.at(dim);
+      decided.factors.emplace_back(dim.getName(), spatial, temporal, sharing);
+      decided.order.push_back(dim.getName());
+    }
+
+    groups.put(key, decided);
+    return decided;
+  }
+
+  // Key of a group mapping: the group's own key, the mesh and the seed
+  static std::string getGroupKey(const DNN::OperatorGroup& group,
+                                 const Architecture::Mesh& mesh,
+                                 uint64_t seed) {
+    BinaryWriter writer;
+    writer.writeString(group.getKey());
+    writer.write(mesh);
+    writer.write(seed);
+
+    const auto& buffer = writer.getBuffer();
+    return std::string(buffer.begin(), buffer.end());
+  }
+
+  // Socket the clients connect to
+  Listener listener;
+
+  // Encoded decisions by query
+  LruCache<std::string, std::vector<char>> decisions;
+
+  // Group mappings by group key
+  LruCache<std::string, GroupDecision> groups;
+
+  // Scheduler shared by all queries
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Client thread and whether its client went away
+  struct Connection {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+  };
+
+  // Client threads not joined yet
+  std::list<Connection> connections;
+
+  // Whether a client asked to stop
+  std::atomic<bool> stopping{false};
+
+  std::atomic<long long> queries{0};
+  std::atomic<long long> cachedQueries{0};
+  std::atomic<long long> cachedGroups{0};
+  std::atomic<long long> mappedGroups{0};
+};
+}  // namespace Distributed
+
+#endif
@@ -1,118 +1,132 @@
 #ifndef DNN_DAG_HPP
 #define DNN_DAG_HPP
 
+#include <numeric>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "operator.hpp"
 
 namespace DNN {
+// Operator graph. It is immutable once constructed, so one instance can be
+// shared by every fusion candidate and every search thread.
 class DAG {
  public:
   template <typename... Ops>
-  DAG(Ops... _ops) : operators{_ops...} {}
+  DAG(Ops... _ops) : operators{_ops...} {
+    connectOperators();
+  }
 
-  // Get the number of tensors
-  auto getNumPotentialFusionTensors() const noexcept { return fused.size(); }
+  explicit DAG(const std::vector<Operator> &_operators)
+      : operators(_operators) {
+    connectOperators();
+  }
 
-  // Get the operators
-  auto getOperators() const noexcept { return operators; }
+  // Get the number of tensors
+  auto getNumPotentialFusionTensors() const noexcept {
+    return fusionTensors.size();
+  }
 
-  // Clear the fusion status
-  void clearFusionStatus() noexcept {
-    for (auto &f : fused) {
-      f.second = false;
-    }
-    fusionEdges.clear();
+  // Get the tensors passed between operators, in fusion bit order
+  const auto &getPotentialFusionTensors() const noexcept {
+    return fusionTensors;
   }
 
-  // Set the fusion status of a tensor
-  void setTensorFusionStatus(const std::vector<bool> &fusionBit) noexcept {
-    clearFusionStatus();
+  // Get the operators
+  const auto &getOperators() const noexcept { return operators; }
 
-    int i = 0;
-    for (auto &f : fused) {
-      f.second = fusionBit[i];
-      i++;
-    }
-  }
+  // Find the connected components when the selected tensors are fused
+  auto findConnectedComponents(const std::vector<bool> &fusionBit) const {
+    std::vector<int> parent(operators.size());
+    std::iota(parent.begin(), parent.end(), 0);
 
-  // Connect the operators
-  void connectOperators() noexcept {
-    for (const auto &op0 : operators)
-      for (const auto &input : op0.getInputs())
-        for (const auto &op1 : operators)
-          for (const auto &output : op1.getOutputs())
-            if (input == output) {
-              edges[std::make_pair(op0, op1)] = input;
-              fused[input] = false;
-            }
-  }
+    auto find = [&](int i) {
+      while (parent[i] != i) i = parent[i] = parent[parent[i]];
+      return i;
+    };
 
-  void connectFusionOperators() noexcept {
-    for (const auto &pair : edges) {
-      if (fused[pair.second]) {
-        fusionEdges[pair.first] = pair.second;
-      }
+    for (const auto &edge : edges) {
+      if (!fusionBit[edge.tensor]) continue;
+      parent[find(edge.consumer)] = find(edge.producer);
     }
-  }
 
-  // Find the connected components
-  auto findConnectedComponents() {
-    std::vector<std::unordered_set<Operator, OperatorHash>> connectedComponents;
-    std::unordered_set<Operator, OperatorHash> visited;
+    // Components in the order of their first operator
+    std::vector<std::vector<Operator>> connectedComponents;
+    std::unordered_map<int, int> component;
 
-    for (const auto &op : operators) {
-      if (visited.find(op) == visited.end()) {
-        std::unordered_set<Operator, OperatorHash> component;
-        dfs(op, visited, component);
-        connectedComponents.push_back(component);
+    for (int i = 0; i < static_cast<int>(operators.size()); i++) {
+      auto root = find(i);
+      auto it = component.find(root);
+      if (it == component.end()) {
+        it = component.emplace(root, connectedComponents.size()).first;
+        connectedComponents.emplace_back();
       }
+      connectedComponents[it->second].push_back(operators[i]);
     }
     return connectedComponents;
   }
 
-  // Depth-first search on the fusion edges
-  void dfs(const Operator &op,
-           std::unordered_set<Operator, OperatorHash> &visited,
-           std::unordered_set<Operator, OperatorHash> &component) {
-    visited.insert(op);
-    component.insert(op);
-
-    for (const auto &nop : operators) {
-      if (fusionEdges.find({op, nop}) != fusionEdges.end() ||
-          fusionEdges.find({nop, op}) != fusionEdges.end()) {
-        if (visited.find(nop) == visited.end()) {
-          dfs(nop, visited, component);
-        }
-      }
-    }
+  // Get the graph with its dimensions resized to a shape. Operators, edges
+  // and fusion bits keep their indices, so fusion decisions carry over.
+  std::shared_ptr<const DAG> resize(const Shape &shape) const {
+    auto graph = std::make_shared<DAG>(*this);
+    for (auto &op : graph->operators) op = op.resize(shape);
+    for (auto &t : graph->fusionTensors) t = t.resize(shape);
+    return graph;
+  }
+
+  // Get the graph with the elements of every tensor of another type
+  std::shared_ptr<const DAG> cast(DataType type) const {
+    auto graph = std::make_shared<DAG>(*this);
+    for (auto &op : graph->operators) op = op.cast(type);
+    for (auto &t : graph->fusionTensors) t = t.cast(type);
+    return graph;
   }
 
   // Find the responding operator pair for a tensor
   std::optional<const std::pair<Operator, Operator>> FindOperatorPair(
       const Tensor &t) const noexcept {
-    for (const auto &pair : edges) {
-      if (pair.second == t) return pair.first;
+    for (const auto &edge : edges) {
+      if (fusionTensors[edge.tensor] == t)
+        return std::make_pair(operators[edge.consumer],
+                              operators[edge.producer]);
     }
     return std::nullopt;
   }
 
  private:
+  // Connect the operators
+  void connectOperators() noexcept {
+    for (int i = 0; i < static_cast<int>(operators.size()); i++)
+      for (const auto &input : operators[i].getInputs())
+        for (int j = 0; j < static_cast<int>(operators.size()); j++)
+          for (const auto &output : operators[j].getOutputs())
+            if (input == output) {
+              auto it = std::find(fusionTensors.begin(), fusionTensors.end(),
+                                  input);
+              int tensor = it - fusionTensors.begin();
+              if (it == fusionTensors.end()) fusionTensors.push_back(input);
+
+              edges.push_back({i, j, tensor});
+            }
+  }
+
+  // Producer-consumer edge, by operator and fusion tensor index
+  struct Edge {
+    int consumer;
+    int producer;
+    int tensor;
+  };
+
   // Operators in the DAG
   std::vector<Operator> operators;
 
-  // Tensors fusion map
-  std::unordered_map<Tensor, bool, TensorHash> fused;
+  // Tensors that may be fused
+  std::vector<Tensor> fusionTensors;
 
   // Edges in the DAG
-  std::unordered_map<std::pair<Operator, Operator>, Tensor, OperatorPairHash>
-      edges;
-
-  // Fusion edges in the DAG
-  std::unordered_map<std::pair<Operator, Operator>, Tensor, OperatorPairHash>
-      fusionEdges;
+  std::vector<Edge> edges;
 };
 
 };  // namespace DNN
-#endif
\ No newline at end of file
+#endif
@@ -6,8 +6,12 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace DNN {
+// Sizes assigned to dimensions by name
+using Shape = std::unordered_map<std::string, int>;
+
 class Dimension {
  public:
   Dimension(std::string _name, int _size) : name(_name), size(_size) {}
@@ -19,11 +23,17 @@ class Dimension {
   bool operator==(const Dimension& other) const { return name == other.name; }
 
   // Get the name of the dimension
-  auto getName() const noexcept { return name; }
+  const auto& getName() const noexcept { return name; }
 
   // Get the size of the dimension
   auto getSize() const noexcept { return size; }
 
+  // Get the dimension with the size a shape assigns to it, if any
+  Dimension resize(const Shape& shape) const {
+    auto it = shape.find(name);
+    return it == shape.end() ? *this : Dimension(name, it->second);
+  }
+
  private:
   // Name of the dimension
   std::string name;
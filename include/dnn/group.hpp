@@ -4,9 +4,19 @@
 #include "dag.hpp"
 
 namespace DNN {
+// How a group materializes its fused tensors
+enum class FusedTensorMode {
+  // Every tile is produced once and held until its consumers used it
+  Store,
+  // Producers run again inside the loop nest of their consumers, so a
+  // fused tensor holds a single tile; a softmax feeding reductions over its
+  // axis rescales their partial results online instead of holding the axis
+  Recompute
+};
+
 class OperatorGroup {
  public:
-  OperatorGroup(std::shared_ptr<DAG> _graph) : graph(_graph) {}
+  OperatorGroup(std::shared_ptr<const DAG> _graph) : graph(_graph) {}
 
   void addOperator(const Operator &op) noexcept { operators.push_back(op); }
 
@@ -53,22 +63,138 @@ class OperatorGroup {
     }
   }
 
+  // A normalization fused with its neighbours needs its whole axis in the
+  // buffer: the fused tensors are never stored, so the axis cannot be swept
+  // more than once. Online normalizations are exempt.
+  void collectResidentDimensions() noexcept {
+    for (const auto &op : operators) {
+      if (!op.isNormalization() || !op.getAxis() || isOnline(op)) continue;
+
+      for (const auto &t : op.getTensors()) {
+        if (!internalTensors.count(t)) continue;
+        residentDimensions.insert(*op.getAxis());
+        break;
+      }
+    }
+  }
+
   void construct() noexcept {
     // Clear the tensors and dimensions set
     tensors.clear();
     dimensions.clear();
     internalTensors.clear();
     externalTensors.clear();
+    residentDimensions.clear();
 
     // Collect the tensors and dimensions
     collectTensors();
     collectDimensions();
     classifyTensorsByTopology();
+    collectResidentDimensions();
+  }
+
+  // Get the group on a resized graph without classifying its tensors again
+  std::shared_ptr<OperatorGroup> resize(std::shared_ptr<const DAG> resized,
+                                        const Shape &shape) const {
+    auto group = std::make_shared<OperatorGroup>(resized);
+    for (const auto &op : operators) group->addOperator(op.resize(shape));
+    for (const auto &t : tensors) group->tensors.insert(t.resize(shape));
+    for (const auto &d : dimensions) group->dimensions.insert(d.resize(shape));
+    for (const auto &t : internalTensors)
+      group->internalTensors.insert(t.resize(shape));
+    for (const auto &t : externalTensors)
+      group->externalTensors.insert(t.resize(shape));
+    for (const auto &d : residentDimensions)
+      group->residentDimensions.insert(d.resize(shape));
+    group->fusedType = fusedType;
+    group->mode = mode;
+    return group;
+  }
+
+  // Get a key identifying the group by its operators
+  std::string getSignature() const noexcept {
+    std::string signature;
+    for (const auto &op : operators) {
+      if (!signature.empty()) signature += ",";
+      signature += op.getName();
+    }
+    return signature;
+  }
+
+  // Get a key identifying everything a mapping of the group depends on: the
+  // operators with their kinds and tensor shapes, which tensors stay
+  // internal, the types they are stored in and how they are materialized
+  std::string getKey() const {
+    auto key = std::to_string(static_cast<int>(mode));
+    for (const auto &op : operators) {
+      key += "|" + op.getName() + ":" +
+             std::to_string(static_cast<int>(op.getKind()));
+      for (const auto &t : op.getTensors()) {
+        key += ";" + t.getName() + (internalTensors.count(t) ? "+" : "-") +
+               std::to_string(static_cast<int>(getStorageType(t)));
+        for (const auto &d : t.getDimensions())
+          key += "," + d.getName() + "=" + std::to_string(d.getSize());
+      }
+    }
+    return key;
   }
 
+  // Set how the fused tensors are materialized
+  void setFusedTensorMode(FusedTensorMode _mode) noexcept {
+    mode = _mode;
+    residentDimensions.clear();
+    collectResidentDimensions();
+  }
+
+  // Get how the fused tensors are materialized
+  auto getFusedTensorMode() const noexcept { return mode; }
+
+  // Get the operators of the group reading a tensor
+  std::vector<Operator> getConsumers(const Tensor &t) const {
+    std::vector<Operator> consumers;
+    for (const auto &op : operators) {
+      const auto &inputs = op.getInputs();
+      if (std::count(inputs.begin(), inputs.end(), t)) consumers.push_back(op);
+    }
+    return consumers;
+  }
+
+  // Check if a softmax streams over its axis with running maxima and sums:
+  // its outputs are recomputed, consumed within the group only, and every
+  // consumer reduces over the axis, so partial results can be rescaled
+  bool isOnline(const Operator &op) const {
+    if (mode != FusedTensorMode::Recompute) return false;
+    if (op.getKind() != OperatorKind::Softmax || !op.getAxis()) return false;
+
+    for (const auto &t : op.getOutputs()) {
+      if (!internalTensors.count(t)) return false;
+      for (const auto &consumer : getConsumers(t))
+        if (!consumer.getReductionDimensions().count(*op.getAxis()))
+          return false;
+    }
+    return true;
+  }
+
+  // Store the fused tensors in a type if it is narrower than their own
+  void setFusedType(std::optional<DataType> _fusedType) noexcept {
+    fusedType = _fusedType;
+  }
+
+  // Get the type a tensor is stored in within the group
+  DataType getStorageType(const Tensor &t) const {
+    if (!fusedType || !internalTensors.count(t)) return t.getType();
+    return getNarrowerType(t.getType(), *fusedType);
+  }
+
+  // Get the dimensions every tile has to hold whole
+  const auto &getResidentDimensions() const noexcept {
+    return residentDimensions;
+  }
+
+  // Get references to the group members
   auto getGroupInfo() const noexcept {
-    return std::make_tuple(operators, tensors, dimensions, internalTensors,
-                           externalTensors);
+    return std::tie(operators, tensors, dimensions, internalTensors,
+                    externalTensors);
   }
 
  private:
@@ -87,8 +213,17 @@ class OperatorGroup {
   // Dimensions in the group
   std::unordered_set<Dimension, DimensionHash> dimensions;
 
+  // Axes of the fused normalizations
+  std::unordered_set<Dimension, DimensionHash> residentDimensions;
+
+  // Type the fused tensors may be narrowed to
+  std::optional<DataType> fusedType;
+
+  // Materialization of the fused tensors
+  FusedTensorMode mode = FusedTensorMode::Store;
+
   // DAG
-  std::shared_ptr<DAG> graph;
+  std::shared_ptr<const DAG> graph;
 };
 
 };  // namespace DNN
@@ -1,22 +1,129 @@
 #ifndef DNN_OPERATOR_HPP
 #define DNN_OPERATOR_HPP
 
+#include <optional>
 #include <set>
 
 #include "tensor.hpp"
 
 namespace DNN {
+// Kind of computation of an operator. It decides the work per point of the
+// iteration space, how often the inputs are swept and which dimensions a
+// fused group has to keep whole.
+enum class OperatorKind {
+  // Contraction over the dimensions missing from the outputs, e.g. MatMul
+  Einsum,
+  // Pointwise map of the inputs, e.g. GELU or a residual add
+  Elementwise,
+  // Exponentials normalized by their sum along an axis
+  Softmax,
+  // Normalization by the mean and variance along an axis
+  LayerNorm
+};
+
 class Operator {
  public:
   template <typename... InTensors, typename... OutTensors>
   Operator(std::string _name, std::vector<Tensor> _inputs,
            std::vector<Tensor> _outputs)
-      : name(_name), inputs(_inputs), outputs(_outputs) {
+      : Operator(_name, OperatorKind::Einsum, _inputs, _outputs) {}
+
+  // Normalizations reduce and broadcast back along the axis, by default the
+  // innermost dimension of their output
+  Operator(std::string _name, OperatorKind _kind, std::vector<Tensor> _inputs,
+           std::vector<Tensor> _outputs,
+           std::optional<Dimension> _axis = std::nullopt)
+      : name(_name),
+        kind(_kind),
+        inputs(_inputs),
+        outputs(_outputs),
+        axis(_axis) {
+    tensors.insert(tensors.end(), inputs.begin(), inputs.end());
+    tensors.insert(tensors.end(), outputs.begin(), outputs.end());
     reductDims = setReductionDimensions();
+    dims = setDimensions();
+
+    if (!isNormalization()) axis.reset();
+    if (isNormalization() && !axis && !outputs.empty() &&
+        !outputs.front().getDimensions().empty())
+      axis = outputs.front().getDimensions().back();
+  }
+
+  // Build an operator from an einsum spec such as "bhmk,bhkn->bhmn": one
+  // index list per input, then per output, each index a single-letter
+  // dimension sized by the shape. Returns nothing if the spec does not
+  // match the tensors or leaves an index unsized.
+  static std::optional<Operator> einsum(
+      const std::string &name, const std::string &spec,
+      const std::vector<std::string> &inputs,
+      const std::vector<std::string> &outputs, const Shape &sizes,
+      OperatorKind kind = OperatorKind::Einsum) {
+    auto arrow = spec.find("->");
+    if (arrow == std::string::npos) return std::nullopt;
+
+    // Split a side of the spec at its commas
+    auto split = [](const std::string &side) {
+      std::vector<std::string> lists(1);
+      for (char c : side) {
+        if (c == ',')
+          lists.emplace_back();
+        else if (c != ' ')
+          lists.back().push_back(c);
+      }
+      return lists;
+    };
+
+    auto in_lists = split(spec.substr(0, arrow));
+    auto out_lists = split(spec.substr(arrow + 2));
+    if (in_lists.size() != inputs.size() || out_lists.size() != outputs.size())
+      return std::nullopt;
+
+    bool sized = true;
+    auto build = [&](const std::vector<std::string> &names,
+                     const std::vector<std::string> &lists) {
+      std::vector<Tensor> built;
+      for (size_t i = 0; i < names.size(); i++) {
+        std::vector<Dimension> tensor_dims;
+        for (char index : lists[i]) {
+          auto it = sizes.find(std::string(1, index));
+          if (it == sizes.end()) {
+            sized = false;
+            continue;
+          }
+          tensor_dims.emplace_back(it->first, it->second);
+        }
+        built.emplace_back(names[i], tensor_dims);
+      }
+      return built;
+    };
+
+    auto in_tensors = build(inputs, in_lists);
+    auto out_tensors = build(outputs, out_lists);
+    if (!sized) return std::nullopt;
+    return Operator(name, kind, in_tensors, out_tensors);
+  }
+
+  // Get the union of the dimensions of all tensors
+  std::set<Dimension> setDimensions() const noexcept {
+    std::set<Dimension> all_dimensions;
+
+    for (const auto &t : inputs) {
+      for (const auto &d : t.getDimensions()) {
+        all_dimensions.insert(d);
+      }
+    }
+
+    for (const auto &t : outputs) {
+      for (const auto &d : t.getDimensions()) {
+        all_dimensions.insert(d);
+      }
+    }
+
+    return all_dimensions;
   }
 
   // Get the reduction dimensions
-  auto setReductionDimensions() const noexcept {
+  std::set<Dimension> setReductionDimensions() const noexcept {
     std::set<Dimension> reduct_dimensions;
 
     for (const auto &t : inputs) {
@@ -36,25 +143,102 @@ class Operator {
     return reduct_dimensions;
   }
 
+  // Get the operator with its tensors resized to a shape
+  Operator resize(const Shape &shape) const {
+    std::vector<Tensor> resized_inputs, resized_outputs;
+    for (const auto &t : inputs) resized_inputs.push_back(t.resize(shape));
+    for (const auto &t : outputs) resized_outputs.push_back(t.resize(shape));
+
+    std::optional<Dimension> resized_axis;
+    if (axis) resized_axis = axis->resize(shape);
+    return Operator(name, kind, resized_inputs, resized_outputs, resized_axis);
+  }
+
+  // Get the operator with the elements of its tensors of another type
+  Operator cast(DataType type) const {
+    std::vector<Tensor> cast_inputs, cast_outputs;
+    for (const auto &t : inputs) cast_inputs.push_back(t.cast(type));
+    for (const auto &t : outputs) cast_outputs.push_back(t.cast(type));
+    return Operator(name, kind, cast_inputs, cast_outputs, axis);
+  }
+
+  // Get the kind
+  auto getKind() const noexcept { return kind; }
+
+  // Check if the operator reduces and broadcasts back along an axis
+  bool isNormalization() const noexcept {
+    return kind == OperatorKind::Softmax || kind == OperatorKind::LayerNorm;
+  }
+
+  // Get the axis of a normalization
+  const auto &getAxis() const noexcept { return axis; }
+
+  // Get the operations per point of the iteration space: a multiply-add,
+  // an elementwise op, max, exponential and scale for softmax, mean,
+  // variance, normalize and affine for layernorm
+  int getWorkPerPoint() const noexcept {
+    switch (kind) {
+      case OperatorKind::Softmax:
+        return 3;
+      case OperatorKind::LayerNorm:
+        return 4;
+      default:
+        return 1;
+    }
+  }
+
+  // Get the sweeps over the inputs when the axis is split into several
+  // tiles: softmax finds the maximum, sums the exponentials and scales,
+  // layernorm gathers the statistics and normalizes. A whole axis is swept
+  // once from the buffer.
+  int getPasses() const noexcept {
+    switch (kind) {
+      case OperatorKind::Softmax:
+        return 3;
+      case OperatorKind::LayerNorm:
+        return 2;
+      default:
+        return 1;
+    }
+  }
+
+  // Get the einsum spec, e.g. "bhmk,bhkn->bhmn"
+  std::string getSpec() const {
+    auto side = [](const std::vector<Tensor> &list) {
+      std::string text;
+      for (const auto &t : list) {
+        if (!text.empty()) text += ",";
+        for (const auto &d : t.getDimensions()) text += d.getName();
+      }
+      return text;
+    };
+    return side(inputs) + "->" + side(outputs);
+  }
+
   // Get the inputs
-  auto getInputs() const noexcept { return inputs; }
+  const auto &getInputs() const noexcept { return inputs; }
 
   // Get the outputs
-  auto getOutputs() const noexcept { return outputs; }
+  const auto &getOutputs() const noexcept { return outputs; }
 
-  // Get all the tensors
-  auto getTensors() const noexcept {
-    std::vector<Tensor> tensors;
-    tensors.insert(tensors.end(), inputs.begin(), inputs.end());
-    tensors.insert(tensors.end(), outputs.begin(), outputs.end());
-    return tensors;
-  }
+  // Get all the tensors, inputs first
+  const auto &getTensors() const noexcept { return tensors; }
 
   // Get the reduction dimensions
-  auto getReductionDimensions() const noexcept { return reductDims; }
+  const auto &getReductionDimensions() const noexcept { return reductDims; }
+
+  // Get the dimensions of the iteration space
+  const auto &getDimensions() const noexcept { return dims; }
+
+  // Get the operations of the whole iteration space
+  long long getComputeCost() const noexcept {
+    long long macs = getWorkPerPoint();
+    for (const auto &d : dims) macs *= d.getSize();
+    return macs;
+  }
 
   // Get the name
-  auto getName() const noexcept { return name; }
+  const auto &getName() const noexcept { return name; }
 
   bool operator==(const Operator &other) const { return name == other.name; }
 
@@ -62,14 +246,26 @@ class Operator {
   // Name of the operator
   std::string name;
 
+  // Kind of computation
+  OperatorKind kind = OperatorKind::Einsum;
+
   // Input tensors
   std::vector<Tensor> inputs;
 
   // Output tensors
   std::vector<Tensor> outputs;
 
+  // Input and output tensors
+  std::vector<Tensor> tensors;
+
   // Reduction dimensions
   std::set<Dimension> reductDims;
+
+  // Iteration space dimensions
+  std::set<Dimension> dims;
+
+  // Axis a normalization reduces and broadcasts along
+  std::optional<Dimension> axis;
 };
 
 struct OperatorHash {
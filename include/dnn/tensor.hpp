@@ -1,24 +1,96 @@
 #ifndef DNN_TENSOR_HPP
 #define DNN_TENSOR_HPP
 
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "dimension.hpp"
 
 namespace DNN {
+// Element type of a tensor
+enum class DataType { FP32, BF16, FP8, INT8, INT32 };
+
+// Get the bytes of one element
+inline int getByteSize(DataType type) noexcept {
+  switch (type) {
+    case DataType::BF16:
+      return 2;
+    case DataType::FP8:
+    case DataType::INT8:
+      return 1;
+    default:
+      return 4;
+  }
+}
+
+// Get the type partial sums of a reduction accumulate in
+inline DataType getAccumulatorType(DataType type) noexcept {
+  return type == DataType::INT8 || type == DataType::INT32 ? DataType::INT32
+                                                           : DataType::FP32;
+}
+
+// Get the narrower of two types
+inline DataType getNarrowerType(DataType a, DataType b) noexcept {
+  return getByteSize(b) < getByteSize(a) ? b : a;
+}
+
+// Get the name of a type, e.g. "bf16"
+inline std::string getTypeName(DataType type) {
+  switch (type) {
+    case DataType::BF16:
+      return "bf16";
+    case DataType::FP8:
+      return "fp8";
+    case DataType::INT8:
+      return "int8";
+    case DataType::INT32:
+      return "int32";
+    default:
+      return "fp32";
+  }
+}
+
+// Get the type of a name given by getTypeName(), if any
+inline std::optional<DataType> parseType(const std::string& name) {
+  for (auto type : {DataType::FP32, DataType::BF16, DataType::FP8,
+                    DataType::INT8, DataType::INT32})
+    if (getTypeName(type) == name) return type;
+  return std::nullopt;
+}
+
 class Tensor {
  public:
   template <typename... Dims>
   Tensor(std::string _name, Dims... dims) : name(_name), dimensions{dims...} {}
 
+  Tensor(std::string _name, std::vector<Dimension> _dimensions,
+         DataType _type = DataType::FP32)
+      : name(_name), dimensions(_dimensions), type(_type) {}
+
   Tensor() : name("null"), dimensions{} {}
 
+  // Get the tensor with its dimensions resized to a shape
+  Tensor resize(const Shape& shape) const {
+    std::vector<Dimension> resized;
+    for (const auto& d : dimensions) resized.push_back(d.resize(shape));
+    return Tensor(name, resized, type);
+  }
+
+  // Get the tensor with its elements of another type
+  Tensor cast(DataType _type) const { return Tensor(name, dimensions, _type); }
+
   // Get the name
-  auto getName() const noexcept { return name; }
+  const auto& getName() const noexcept { return name; }
 
   // Get the dimensions
-  auto getDimensions() const noexcept { return dimensions; }
+  const auto& getDimensions() const noexcept { return dimensions; }
+
+  // Get the element type
+  auto getType() const noexcept { return type; }
+
+  // Get the bytes of one element
+  int getByteSize() const noexcept { return DNN::getByteSize(type); }
 
   // Compare two tensors
   bool operator==(const Tensor& other) const { return name == other.name; }
@@ -31,6 +103,9 @@ class Tensor {
 
   // Dimensions of the tensor
   std::vector<Dimension> dimensions;
+
+  // Element type of the tensor
+  DataType type = DataType::FP32;
 };
 
 struct TensorHash {
@@ -0,0 +1,283 @@
+#ifndef EXPLORE_HPP
+#define EXPLORE_HPP
+
+#include <array>
+#include <map>
+
+#include "fusion.hpp"
+
+// Values of every swept mesh parameter. A parameter left empty keeps the
+// value of the base mesh.
+struct MeshGrid {
+  std::vector<int> coreNum;
+  std::vector<int> footprintPerCore;
+  std::vector<int> onchipBandwidth;
+  std::vector<int> offchipBandwidth;
+
+  // Set the values of a parameter by its name; false if there is none
+  bool set(const std::string &name, const std::vector<int> &values) {
+    if (name == "coreNum")
+      coreNum = values;
+    else if (name == "footprintPerCore")
+      footprintPerCore = values;
+    else if (name == "onchipBandwidth")
+      onchipBandwidth = values;
+    else if (name == "offchipBandwidth")
+      offchipBandwidth = values;
+    else
+      return false;
+    return true;
+  }
+
+  // Every combination of the values, the last parameter varying fastest
+  std::vector<Architecture::Mesh> expand(
+      const Architecture::Mesh &base) const {
+    auto or_base = [](const std::vector<int> &values, int value) {
+      return values.empty() ? std::vector<int>{value} : values;
+    };
+
+    std::vector<Architecture::Mesh> meshes;
+    for (int c : or_base(coreNum, base.coreNum))
+      for (int f : or_base(footprintPerCore, base.footprintPerCore))
+        for (int on : or_base(onchipBandwidth, base.onchipBandwidth))
+          for (int off : or_base(offchipBandwidth, base.offchipBandwidth)) {
+            auto mesh = base;
+            mesh.coreNum = c;
+            mesh.footprintPerCore = f;
+            mesh.onchipBandwidth = on;
+            mesh.offchipBandwidth = off;
+            meshes.push_back(mesh);
+          }
+    return meshes;
+  }
+};
+
+// Area proxies of a mesh, each growing with one kind of silicon: compute
+// lanes, buffer capacity, on-chip links and off-chip interface
+inline std::array<long long, 4> getAreaProxies(const Architecture::Mesh &mesh) {
+  return {1LL * mesh.coreNum * mesh.computeThroughput,
+          1LL * mesh.coreNum * mesh.footprintPerCore,
+          1LL * mesh.coreNum * mesh.onchipBandwidth, mesh.offchipBandwidth};
+}
+
+// Result of one mesh of an exploration
+struct ArchitecturePoint {
+  Architecture::Mesh mesh;
+
+  // Best fusion candidate on the mesh and its cost; the fusion stays empty
+  // if no candidate fits the buffers
+  std::vector<bool> fusion;
+  int cost = std::numeric_limits<int>::max();
+
+  // Best mapping of each group of the candidate
+  std::vector<Mapping> mappings;
+
+  // Area proxies of the mesh
+  std::array<long long, 4> area{};
+
+  // Whether no other point is as cheap and as small in every proxy, and
+  // strictly better in one
+  bool pareto = false;
+};
+
+// Counts of an exploration
+struct ExplorationStatistics {
+  // Group searches run, and group results shared by several points or
+  // candidates
+  long long mappedGroups = 0;
+  long long reusedGroups = 0;
+
+  // Group results skipped as no partition fits the buffer
+  long long infeasibleGroups = 0;
+};
+
+// Evaluates one model over a grid of meshes in a single process. The fusion
+// candidates and their groups are built once. A group is searched once per
+// mesh that can change its result: every group maps the same in every
+// candidate, and buffers larger than the group's biggest partition leave
+// every partition feasible, so such meshes share one search. Meshes with a
+// larger buffer also inherit better mappings found on smaller ones, which
+// keeps the best cost monotone in the buffer size.
+class ArchitectureSweep {
+ public:
+  ArchitectureSweep(
+      const std::shared_ptr<const DNN::DAG> _operatorGraph,
+      uint64_t _seed = 0,
+      const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : operatorGraph(_operatorGraph), seed(_seed), scheduler(_scheduler) {}
+
+  std::vector<ArchitecturePoint> run(
+      const std::vector<Architecture::Mesh> &meshes) {
+    statistics = {};
+
+    FusionSpace fs(operatorGraph, seed);
+    int tensor_num = operatorGraph->getNumPotentialFusionTensors();
+    int combinations = 1 << tensor_num;
+
+    // Groups of every candidate, numbered across candidates by structure
+    std::vector<std::vector<bool>> bits(combinations);
+    std::vector<std::vector<int>> candidates(combinations);
+    std::vector<std::shared_ptr<DNN::OperatorGroup>> groups;
+    std::unordered_map<std::string, int> group_index;
+    for (int i = 0; i < combinations; i++) {
+      bits[i].resize(tensor_num);
+      for (int j = 0; j < tensor_num; j++) bits[i][j] = (i >> j) & 1;
+
+      for (const auto &group : fs.generateCandidateGroups(bits[i])) {
+        auto [it, inserted] =
+            group_index.emplace(group->getKey(), groups.size());
+        if (inserted) groups.push_back(group);
+        candidates[i].push_back(it->second);
+      }
+    }
+
+    // Footprint range of every group, independent of the mesh
+    std::vector<int> floors(groups.size());
+    std::vector<int> ceilings(groups.size());
+    auto base = std::make_shared<Architecture::Mesh>();
+    Runtime::parallelFor(scheduler, groups.size(), [&](int g) {
+      PartitionAnalysis analysis(groups[g], base);
+      floors[g] = analysis.getFootprintBound();
+      ceilings[g] = analysis.getFootprintCeiling();
+    });
+
+    // Searches of the groups on every mesh, -1 if the group does not fit
+    std::vector<std::vector<int>> searches(
+        meshes.size(), std::vector<int>(groups.size(), -1));
+    std::vector<std::pair<int, Architecture::Mesh>> tasks;
+    std::map<std::tuple<int, int, int, int, int, int>, int> task_index;
+
+    // Candidates holding every group
+    std::vector<int> holders(groups.size());
+    for (const auto &candidate : candidates)
+      for (int g : candidate) holders[g]++;
+    long long uses = 0;
+    for (size_t m = 0; m < meshes.size(); m++) {
+      for (size_t g = 0; g < groups.size(); g++) {
+        auto mesh = meshes[m];
+        if (mesh.footprintPerCore <= floors[g]) {
+          statistics.infeasibleGroups++;
+          continue;
+        }
+
+        // Any buffer above the ceiling admits the same partitions
+        mesh.footprintPerCore = std::min(mesh.footprintPerCore,
+                                         ceilings[g] + 1);
+
+        auto key = std::make_tuple(
+            static_cast<int>(g), mesh.coreNum, mesh.onchipBandwidth,
+            mesh.offchipBandwidth, mesh.computeThroughput,
+            mesh.footprintPerCore);
+        auto [it, inserted] = task_index.emplace(key, tasks.size());
+        if (inserted) tasks.emplace_back(g, mesh);
+        searches[m][g] = it->second;
+        uses += holders[g];
+      }
+    }
+
+    std::vector<int> costs(tasks.size());
+    std::vector<Mapping> mappings(tasks.size());
+    Runtime::parallelFor(scheduler, tasks.size(), [&](int t) {
+      auto [g, mesh] = tasks[t];
+      auto analysis = std::make_shared<PartitionAnalysis>(
+          groups[g], std::make_shared<Architecture::Mesh>(mesh));
+
+      // Seeded by the group alone, so shared results are the ones each
+      // point would have searched for itself
+      auto group_seed = Algorithm::Random::derive(
+          seed, std::hash<std::string>()(groups[g]->getKey()));
+      Mapper mapper(analysis, group_seed, scheduler);
+      mapper.search();
+      costs[t] = mapper.getBestCost();
+      mappings[t] = mapper.getBestMapping();
+    });
+
+    statistics.mappedGroups = tasks.size();
+    statistics.reusedGroups = uses - tasks.size();
+
+    // A partition that fits a buffer fits every larger one, so a group may
+    // take the best mapping found for it on a mesh with a smaller buffer.
+    // The keys order the searches of a group by buffer size, with the
+    // other parameters outermost.
+    for (auto it = task_index.begin(); it != task_index.end(); ++it) {
+      if (it == task_index.begin()) continue;
+      auto prev = std::prev(it);
+      if (std::get<0>(it->first) != std::get<0>(prev->first) ||
+          std::get<1>(it->first) != std::get<1>(prev->first) ||
+          std::get<2>(it->first) != std::get<2>(prev->first) ||
+          std::get<3>(it->first) != std::get<3>(prev->first) ||
+          std::get<4>(it->first) != std::get<4>(prev->first))
+        continue;
+      if (costs[prev->second] >= costs[it->second]) continue;
+
+      costs[it->second] = costs[prev->second];
+      mappings[it->second] = mappings[prev->second];
+    }
+
+    // Best candidate of every mesh; groups run one after another
+    std::vector<ArchitecturePoint> points(meshes.size());
+    for (size_t m = 0; m < meshes.size(); m++) {
+      auto &point = points[m];
+      point.mesh = meshes[m];
+      point.area = getAreaProxies(meshes[m]);
+
+      for (int i = 0; i < combinations; i++) {
+        long long total = 0;
+        for (int g : candidates[i]) {
+          int t = searches[m][g];
+          total += t < 0 ? std::numeric_limits<int>::max() : costs[t];
+        }
+        if (total >= point.cost) continue;
+
+        point.fusion = bits[i];
+        point.cost = static_cast<int>(total);
+        point.mappings.clear();
+        for (int g : candidates[i])
+          point.mappings.push_back(mappings[searches[m][g]]);
+      }
+    }
+
+    markPareto(points);
+    return points;
+  }
+
+  // Get the statistics of the last run
+  auto getStatistics() const noexcept { return statistics; }
+
+ private:
+  // Mark the points no other point dominates in cost and area
+  static void markPareto(std::vector<ArchitecturePoint> &points) {
+    auto dominates = [](const ArchitecturePoint &a,
+                        const ArchitecturePoint &b) {
+      bool better = a.cost < b.cost;
+      if (a.cost > b.cost) return false;
+      for (size_t i = 0; i < a.area.size(); i++) {
+        if (a.area[i] > b.area[i]) return false;
+        better |= a.area[i] < b.area[i];
+      }
+      return better;
+    };
+
+    for (auto &point : points) {
+      point.pareto = !point.fusion.empty();
+      for (const auto &other : points) {
+        if (other.fusion.empty() || !dominates(other, point)) continue;
+        point.pareto = false;
+        break;
+      }
+    }
+  }
+
+  std::shared_ptr<const DNN::DAG> operatorGraph;
+
+  // Seed of every search
+  uint64_t seed;
+
+  // Scheduler of the searches, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Statistics of the last run
+  ExplorationStatistics statistics;
+};
+
+#endif
@@ -2,21 +2,26 @@
 #define FUSION_HPP
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <limits>
+#include <sstream>
 
+#include "checkpoint.hpp"
 #include "dnn/dag.hpp"
 #include "dnn/group.hpp"
+#include "joint.hpp"
 #include "mapper.hpp"
+#include "multichip.hpp"
+#include "pipeline.hpp"
 
 class RandomSearch {
  public:
-  RandomSearch(int _numIterations) : numIterations(_numIterations) {
-    srand(time(0));
-  }
+  RandomSearch(int _numIterations, uint64_t seed = 0)
+      : numIterations(_numIterations), rng(seed) {}
 
   auto search(const std::vector<bool> &design_space,
-              const std::function<int(std::vector<bool>)> eval) const noexcept {
+              const std::function<int(std::vector<bool>)> eval) noexcept {
     // Randomly search the fusion space
     int best_score = std::numeric_limits<int>::infinity();
     std::vector<bool> solution;
@@ -25,7 +30,7 @@ class RandomSearch {
       // Randomly select the tensors to fuse
       auto candidate = std::vector<bool>(design_space.size(), false);
       for (int j = 0; j < static_cast<int>(design_space.size()); j++) {
-        candidate[j] = static_cast<bool>(rand() % 2);
+        candidate[j] = static_cast<bool>(rng.uniformInt(2));
       }
 
       // Evaluate the fusion strategy
@@ -43,54 +48,199 @@ class RandomSearch {
 
  private:
   int numIterations;
+
+  // Random stream of the search
+  Algorithm::Random rng;
 };
 
 class TraverseSearch {
  public:
-  TraverseSearch() = default;
+  TraverseSearch(const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : scheduler(_scheduler) {}
+
+  // Snapshot the evaluated candidates while searching, at most once per
+  // period and once at the end
+  void setCheckpointer(const std::shared_ptr<Checkpointer> _checkpointer,
+                       std::chrono::milliseconds _period =
+                           std::chrono::milliseconds(1000)) {
+    checkpointer = _checkpointer;
+    period = _period;
+  }
+
+  // Encode the evaluated candidates (the enumeration cursor)
+  void save(BinaryWriter &writer) const {
+    writer.writeBits(done);
+    for (int i = 0; i < static_cast<int>(done.size()); i++)
+      if (done[i]) writer.write(scores[i]);
+  }
+
+  // Restore the candidates evaluated before a restart
+  bool restore(BinaryReader &reader) {
+    done = reader.readBits();
+    scores.assign(done.size(), 0);
+    for (int i = 0; i < static_cast<int>(done.size()); i++)
+      if (done[i]) scores[i] = reader.read<int>();
+    return reader.isGood();
+  }
 
   auto search(const std::vector<bool> &design_space,
-              const std::function<int(std::vector<bool>)> eval) const noexcept {
-    int best_score = std::numeric_limits<int>::infinity();
+              const std::function<int(std::vector<bool>)> eval) noexcept {
+    int best_score = std::numeric_limits<int>::max();
     std::vector<bool> solution;
 
     int size = static_cast<int>(design_space.size());
     int combinations = 1 << size;
 
-    for (int i = 0; i < combinations; i++) {
-      // Traverse the combinations
-      auto candidate = std::vector<bool>(size, false);
+    // Keep what a restored checkpoint already evaluated
+    if (static_cast<int>(done.size()) != combinations) {
+      done.assign(combinations, false);
+      scores.assign(combinations, 0);
+    }
+    auto last = std::chrono::steady_clock::now();
+
+    // Traverse the combinations
+    auto candidate = [&](int i) {
+      auto bits = std::vector<bool>(size, false);
 
       for (int j = 0; j < size; j++) {
-        candidate[j] = (i >> j) & 1;
+        bits[j] = (i >> j) & 1;
       }
+      return bits;
+    };
 
-      // Evaluate the fusion strategy
-      auto score = eval(candidate);
+    // Only the pending combinations, as the tasks mark theirs done
+    std::vector<int> pending;
+    for (int i = 0; i < combinations; i++)
+      if (!done[i]) pending.push_back(i);
+
+    // Evaluate the fusion strategies concurrently
+    int num = static_cast<int>(pending.size());
+    Runtime::parallelFor(scheduler, num, [&](int k) {
+      int i = pending[k];
+      int score = eval(candidate(i));
+
+      std::lock_guard<std::mutex> lock(mutex);
+      scores[i] = score;
+      done[i] = true;
+
+      auto now = std::chrono::steady_clock::now();
+      if (!checkpointer || now - last < period) return;
+      last = now;
+      snapshot();
+    });
+
+    if (checkpointer) {
+      snapshot();
+      checkpointer->flush();
+    }
 
-      // Update the best solution
-      if (score > best_score) continue;
+    for (int i = 0; i < combinations; i++) {
+      // Update the best solution, the first one wins ties
+      if (!solution.empty() && scores[i] >= best_score) continue;
 
-      best_score = score;
-      solution = candidate;
+      best_score = scores[i];
+      solution = candidate(i);
     }
 
+    bestScore = best_score;
     return solution;
   }
+
+  // Get the score of the solution of the last search
+  int getBestScore() const noexcept { return bestScore; }
+
+ private:
+  void snapshot() {
+    BinaryWriter writer;
+    save(writer);
+    checkpointer->submit(writer.getBuffer());
+  }
+
+  // Scheduler of the evaluations, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Whether each candidate was evaluated, and its score
+  std::vector<bool> done;
+  std::vector<int> scores;
+
+  // Score of the solution of the last search
+  int bestScore = std::numeric_limits<int>::max();
+
+  // Guard of the evaluation records
+  std::mutex mutex;
+
+  // Writer of snapshots and the minimal time between two of them
+  std::shared_ptr<Checkpointer> checkpointer;
+  std::chrono::milliseconds period{1000};
 };
 
 class FusionSpace {
  public:
-  FusionSpace(const std::shared_ptr<DNN::DAG> _operatorGraph)
-      : operatorGraph(_operatorGraph) {}
+  FusionSpace(const std::shared_ptr<const DNN::DAG> _operatorGraph,
+              uint64_t _seed = 0)
+      : operatorGraph(_operatorGraph), seed(_seed) {}
+
+  // Get the graph whose fusion candidates are searched
+  auto getOperatorGraph() const noexcept { return operatorGraph; }
+
+  // Checkpoint the enumeration to a file and resume from it if it exists
+  void setCheckpoint(const std::string &path) { checkpointPath = path; }
+
+  // Run fusion candidates, groups and evaluations through the scheduler
+  void setScheduler(const std::shared_ptr<Runtime::Scheduler> _scheduler) {
+    scheduler = _scheduler;
+  }
+
+  // Also map every fused group with its fused tensors recomputed inside the
+  // consumers' loop nests, keeping the cheaper way
+  void setRecompute(bool _recompute) noexcept { recompute = _recompute; }
+
+  // Overlap the transfers of every group's next tile with the computation
+  // of the current one, as PartitionAnalysis::setDoubleBuffering
+  void setDoubleBuffering(bool _doubleBuffering) noexcept {
+    doubleBuffering = _doubleBuffering;
+  }
+
+  // Let fused intermediates be kept in a narrower type than their own, e.g.
+  // bf16 activations in fp8 between two operators of a group
+  void setFusedPrecision(std::optional<DNN::DataType> _fusedType) noexcept {
+    fusedType = _fusedType;
+  }
+
+  // Prescreen the candidates of every group's search with a surrogate, as
+  // Mapper::setSurrogateFraction
+  void setSurrogateFraction(double _surrogateFraction) noexcept {
+    surrogateFraction = _surrogateFraction;
+  }
+
+  // Race the named search strategies on every group instead of running
+  // the genetic algorithm alone
+  void setPortfolio(const std::vector<std::string> &_portfolio) {
+    portfolio = _portfolio;
+  }
+
+  // Polish the mappings of every group by local search, as
+  // Mapper::setLocalSearch
+  void setLocalSearch(Descent _descent, long long _budget,
+                      int _elites = 0) noexcept {
+    descent = _descent;
+    localBudget = _budget;
+    elites = _elites;
+  }
+
+  // Keep the loop orders of every group canonical, as
+  // Mapper::setCanonicalOrders
+  void setCanonicalOrders(bool _canonical, long long _exhaustive = 0) noexcept {
+    canonical = _canonical;
+    exhaustive = _exhaustive;
+  }
 
   auto generateOperatorGroups(
-      const std::vector<std::unordered_set<DNN::Operator, DNN::OperatorHash>>
-          &connected) const noexcept {
+      const std::vector<std::vector<DNN::Operator>> &connected) const noexcept {
     std::vector<std::shared_ptr<DNN::OperatorGroup>> opGroups;
 
     for (const auto &con : connected) {
-      // con: std::unordered_set<DNN::Operator, DNN::OperatorHash>
+      // con: std::vector<DNN::Operator>
 
       // Initialize the operator group
       auto opGroup = std::make_shared<DNN::OperatorGroup>(operatorGraph);
@@ -99,50 +249,388 @@ class FusionSpace {
         opGroup->addOperator(op);
       }
       opGroup->construct();
+      opGroup->setFusedType(fusedType);
       opGroups.push_back(opGroup);
     }
 
     return opGroups;
   }
 
-  // TODO: implement the searchFusionSpace function
-  void searchFusionSpace(
-      const std::shared_ptr<Architecture::Mesh> mesh) const noexcept {
+  // Generate the operator groups of a fusion candidate
+  auto generateCandidateGroups(
+      const std::vector<bool> &fusion_bit) const noexcept {
+    return generateOperatorGroups(
+        operatorGraph->findConnectedComponents(fusion_bit));
+  }
+
+  // Get the ways to materialize the fused tensors of a group: stored, and
+  // recomputed if enabled and the group fuses any tensor
+  std::vector<std::shared_ptr<DNN::OperatorGroup>> getGroupVariants(
+      const std::shared_ptr<DNN::OperatorGroup> group) const {
+    std::vector<std::shared_ptr<DNN::OperatorGroup>> variants{group};
+    if (!recompute || std::get<3>(group->getGroupInfo()).empty())
+      return variants;
+
+    auto recomputed = std::make_shared<DNN::OperatorGroup>(*group);
+    recomputed->setFusedTensorMode(DNN::FusedTensorMode::Recompute);
+    variants.push_back(recomputed);
+    return variants;
+  }
+
+  // Get a mapper of a group variant with the settings of the space
+  std::shared_ptr<Mapper> makeMapper(
+      const std::shared_ptr<DNN::OperatorGroup> variant,
+      const std::shared_ptr<Architecture::Mesh> mesh,
+      uint64_t group_seed) const {
+    auto analysis = std::make_shared<PartitionAnalysis>(variant, mesh);
+    analysis->setDoubleBuffering(doubleBuffering);
+    auto mapper = std::make_shared<Mapper>(analysis, group_seed, scheduler);
+    mapper->setSurrogateFraction(surrogateFraction);
+    mapper->setPortfolio(portfolio);
+    mapper->setLocalSearch(descent, localBudget, elites);
+    mapper->setCanonicalOrders(canonical, exhaustive);
+    return mapper;
+  }
+
+  // Map one group and return its best cost over its variants
+  int mapGroup(const std::shared_ptr<DNN::OperatorGroup> group,
+               const std::shared_ptr<Architecture::Mesh> mesh,
+               uint64_t group_seed) const noexcept {
+    int best = std::numeric_limits<int>::max();
+    std::string winner;
+    auto mode = DNN::FusedTensorMode::Store;
+    for (const auto &variant : getGroupVariants(group)) {
+      auto mapper = makeMapper(variant, mesh, group_seed);
+
+      // Every mapping of a variant under a seed resumes from its own files
+      if (!checkpointPath.empty()) {
+        std::ostringstream name;
+        name << checkpointPath << ".group-" << std::hex
+             << Algorithm::Random::derive(
+                    group_seed, std::hash<std::string>()(variant->getKey()));
+        mapper->setCheckpoint(name.str());
+      }
+
+      mapper->search();
+      {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        statistics.add(mapper->getStatistics());
+      }
+      if (mapper->getBestCost() >= best) continue;
+      best = mapper->getBestCost();
+      winner = mapper->getWinner();
+      mode = variant->getFusedTensorMode();
+    }
+
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    if (!winner.empty()) strategyWins[winner]++;
+    if (best < std::numeric_limits<int>::max())
+      groupModes[{group->getKey(), group_seed}] = mode;
+    return best;
+  }
+
+  // Lower bound of the best cost of a group before mapping it, or the
+  // cost of an unmapped group if no partition fits a core's buffer
+  int boundGroup(const std::shared_ptr<DNN::OperatorGroup> group,
+                 const std::shared_ptr<Architecture::Mesh> mesh) const {
+    int best = std::numeric_limits<int>::max();
+    for (const auto &variant : getGroupVariants(group)) {
+      PartitionAnalysis analysis(variant, mesh);
+      analysis.setDoubleBuffering(doubleBuffering);
+      if (!analysis.isFeasible()) continue;
+
+      best = std::min<long long>(best, analysis.getCostBound());
+    }
+    return best;
+  }
+
+  // Seed of a fusion candidate, independent of visiting order
+  uint64_t getCandidateSeed(
+      const std::vector<bool> &fusion_bit) const noexcept {
+    uint64_t candidate = 0;
+    for (int j = 0; j < static_cast<int>(fusion_bit.size()); j++)
+      candidate |= uint64_t(fusion_bit[j]) << j;
+
+    return Algorithm::Random::derive(seed, candidate);
+  }
+
+  // Seed of group g of a fusion candidate
+  uint64_t getGroupSeed(const std::vector<bool> &fusion_bit,
+                        int g) const noexcept {
+    return Algorithm::Random::derive(getCandidateSeed(fusion_bit), g);
+  }
+
+  // Seed of a group by its key, the same in every candidate holding it
+  uint64_t getGroupSeed(const DNN::OperatorGroup &group) const {
+    return Algorithm::Random::derive(seed,
+                                     std::hash<std::string>()(group.getKey()));
+  }
+
+  // Schedule the groups of a fusion candidate as a spatial pipeline
+  auto planPipeline(const std::vector<bool> &fusion_bit,
+                    const std::shared_ptr<Architecture::Mesh> mesh,
+                    int micro_batches) const {
+    PipelinePlanner planner(generateCandidateGroups(fusion_bit), mesh,
+                            getCandidateSeed(fusion_bit), scheduler);
+    planner.setMicroBatches(micro_batches);
+    return planner.plan();
+  }
+
+  // Search the fusion candidate whose pipeline has the highest throughput
+  auto searchPipeline(const std::shared_ptr<Architecture::Mesh> mesh,
+                      int micro_batches) const {
+    int tensor_num = operatorGraph->getNumPotentialFusionTensors();
+    TraverseSearch ts(scheduler);
+
+    return ts.search(std::vector<bool>(tensor_num, false),
+                     [&](const std::vector<bool> &fusion_bit) {
+                       auto report =
+                           planPipeline(fusion_bit, mesh, micro_batches);
+                       return static_cast<int>(std::min<long long>(
+                           report.interval, std::numeric_limits<int>::max()));
+                     });
+  }
+
+  // Place the groups of a fusion candidate on the chips of a system
+  auto planSystem(const std::vector<bool> &fusion_bit,
+                  const std::shared_ptr<Architecture::System> system,
+                  int micro_batches, SystemObjective objective) const {
+    SystemPlanner planner(operatorGraph, generateCandidateGroups(fusion_bit),
+                          system, getCandidateSeed(fusion_bit), scheduler);
+    planner.setMicroBatches(micro_batches);
+    planner.setObjective(objective);
+    return planner.plan();
+  }
+
+  // Search the fusion candidate whose placement on a system best meets the
+  // objective
+  auto searchSystem(const std::shared_ptr<Architecture::System> system,
+                    int micro_batches, SystemObjective objective) const {
+    int tensor_num = operatorGraph->getNumPotentialFusionTensors();
+    TraverseSearch ts(scheduler);
+
+    return ts.search(std::vector<bool>(tensor_num, false),
+                     [&](const std::vector<bool> &fusion_bit) {
+                       auto report = planSystem(fusion_bit, system,
+                                                micro_batches, objective);
+                       auto cycles = objective == SystemObjective::Latency
+                                         ? report.latency
+                                         : report.interval;
+                       return static_cast<int>(std::min<long long>(
+                           cycles, std::numeric_limits<int>::max()));
+                     });
+  }
+
+  // Search the fusion space and return the fusion bits of the best candidate.
+  // Candidates and groups whose lower bounds exceed the best total cost so
+  // far, or that cannot fit a core's buffer, are skipped without mapping.
+  auto searchFusionSpace(const std::shared_ptr<Architecture::Mesh> mesh) {
     // Randomly fuse operators
 
     // Get the number of tensors
-    operatorGraph->connectOperators();
     int tensor_num = operatorGraph->getNumPotentialFusionTensors();
     auto fusion_bit = std::vector<bool>(tensor_num, false);
 
     // Traverse the search space
-    TraverseSearch ts;
+    TraverseSearch ts(scheduler);
+
+    if (!checkpointPath.empty()) {
+      if (auto snapshot = Checkpointer::load(checkpointPath)) {
+        BinaryReader reader(*snapshot);
+        ts.restore(reader);
+      }
+      ts.setCheckpointer(std::make_shared<Checkpointer>(checkpointPath));
+    }
+
+    // Best total cost so far
+    std::atomic<int> incumbent{std::numeric_limits<int>::max()};
+    prunedCandidates = 0;
+    prunedGroups = 0;
+    {
+      std::lock_guard<std::mutex> lock(resultsMutex);
+      strategyWins.clear();
+      groupModes.clear();
+      statistics = {};
+    }
 
     auto eval = [&](const std::vector<bool> &fusion_bit) -> int {
       // Evaluate the fusion strategy
 
-      // Fuse the selected tensors
-      operatorGraph->setTensorFusionStatus(fusion_bit);
+      // Get the operator groups with the selected tensors fused
+      auto groups = generateCandidateGroups(fusion_bit);
+
+      // Bound every group before mapping any
+      std::vector<int> bounds(groups.size());
+      Runtime::parallelFor(scheduler, groups.size(), [&](int g) {
+        bounds[g] = boundGroup(groups[g], mesh);
+      });
+
+      // Lower bound of the total, tightened as groups are mapped
+      long long sum = 0;
+      for (auto bound : bounds) sum += bound;
+      std::atomic<long long> total{sum};
+
+      bool infeasible = std::count(bounds.begin(), bounds.end(),
+                                   std::numeric_limits<int>::max());
+      if (infeasible || total > incumbent) {
+        prunedCandidates++;
+        return std::numeric_limits<int>::max();
+      }
+
+      // Map the groups concurrently
+      std::atomic<bool> pruned{false};
+      Runtime::parallelFor(scheduler, groups.size(), [&](int g) {
+        if (total > incumbent) {
+          pruned = true;
+          prunedGroups++;
+          return;
+        }
+
+        int cost = mapGroup(groups[g], mesh, getGroupSeed(fusion_bit, g));
+        total += cost - bounds[g];
+      });
+
+      if (pruned) {
+        prunedCandidates++;
+        return std::numeric_limits<int>::max();
+      }
+
+      // Groups run one after another
+      int cost = static_cast<int>(
+          std::min<long long>(total, std::numeric_limits<int>::max()));
 
-      // Get the operator groups
-      operatorGraph->connectFusionOperators();
-      auto connected = operatorGraph->findConnectedComponents();
-      auto operators = operatorGraph->getOperators();
+      int best = incumbent;
+      while (cost < best && !incumbent.compare_exchange_weak(best, cost)) {
+      }
+      return cost;
+    };
 
-      auto groups = generateOperatorGroups(connected);
+    auto best = ts.search(fusion_bit, eval);
+    bestCost = ts.getBestScore();
+    return best;
+  }
 
-      auto analysis = std::make_shared<PartitionAnalysis>(groups, mesh);
-      auto mapper = std::make_shared<Mapper>(analysis);
+  // Get the total cost of the best candidate of the last fusion space search
+  int getBestCost() const noexcept { return bestCost; }
 
-      mapper->search();
+  // Get the number of candidates the last fusion space search skipped
+  int getPrunedCandidates() const noexcept { return prunedCandidates; }
 
-      return 0;
-    };
+  // Get the number of groups left unmapped in those candidates
+  int getPrunedGroups() const noexcept { return prunedGroups; }
 
-    auto best_solution = ts.search(fusion_bit, eval);
+  // Get the number of groups of the last fusion space search each strategy
+  // found the best mapping of
+  std::map<std::string, int> getStrategyWins() const {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    return strategyWins;
+  }
+
+  // Get how the groups of a candidate mapped by the last fusion space search
+  // materialize their fused tensors at their best, by signature; groups
+  // left unmapped are missing
+  std::vector<std::pair<std::string, DNN::FusedTensorMode>> getGroupModes(
+      const std::vector<bool> &fusion_bit) const {
+    auto groups = generateCandidateGroups(fusion_bit);
+    std::vector<std::pair<std::string, DNN::FusedTensorMode>> modes;
+
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    for (int g = 0; g < static_cast<int>(groups.size()); g++) {
+      auto it = groupModes.find(
+          {groups[g]->getKey(), getGroupSeed(fusion_bit, g)});
+      if (it != groupModes.end())
+        modes.emplace_back(groups[g]->getSignature(), it->second);
+    }
+    return modes;
+  }
+
+  // Get the statistics of every group search of the last fusion space
+  // search together
+  Algorithm::SearchStatistics getSearchStatistics() const {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    return statistics;
+  }
+
+  // Search fusion and mapping together with MCTS instead of mapping every
+  // fusion candidate with its own GA; returns the best terminal state
+  auto searchJointly(const std::shared_ptr<Architecture::Mesh> mesh,
+                     int budget) const {
+    auto space = std::make_shared<JointSpace>(
+        [this](const std::vector<bool> &fusion_bit) {
+          return generateCandidateGroups(fusion_bit);
+        },
+        operatorGraph->getNumPotentialFusionTensors(), mesh);
+
+    Algorithm::MonteCarloTreeSearch mcts(
+        budget, std::make_shared<JointState>(space), seed);
+
+    if (!checkpointPath.empty()) {
+      if (auto snapshot = Checkpointer::load(checkpointPath)) {
+        BinaryReader reader(*snapshot);
+        mcts.restore(reader, [&](BinaryReader &r) {
+          return JointState::load(r, space);
+        });
+      }
+      mcts.setCheckpointer(std::make_shared<Checkpointer>(checkpointPath),
+                           std::max(1, budget / 100));
+    }
+
+    mcts.search();
+    return std::dynamic_pointer_cast<JointState>(mcts.getBestState());
   }
 
  private:
-  std::shared_ptr<DNN::DAG> operatorGraph;
+  std::shared_ptr<const DNN::DAG> operatorGraph;
+
+  // Seed of every random stream in the search
+  uint64_t seed;
+
+  // Scheduler of the search, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Checkpoint file of the enumeration, empty to disable
+  std::string checkpointPath;
+
+  // Type fused intermediates may be narrowed to
+  std::optional<DNN::DataType> fusedType;
+
+  // Whether fused tensors may be recomputed
+  bool recompute = false;
+
+  // Whether transferred tiles are double-buffered
+  bool doubleBuffering = false;
+
+  // Fraction of every group's candidates evaluated exactly (0 disables the
+  // surrogate)
+  double surrogateFraction = 0.0;
+
+  // Strategies raced on every group, the genetic algorithm alone if empty
+  std::vector<std::string> portfolio;
+
+  // Local search of every group's mappings, off with a budget of 0
+  Descent descent = Descent::Steepest;
+  long long localBudget = 0;
+  int elites = 0;
+
+  // Canonical loop orders of every group, and the most tried exhaustively
+  bool canonical = false;
+  long long exhaustive = 0;
+
+  // Total cost of the best candidate of the last fusion space search
+  int bestCost = std::numeric_limits<int>::max();
+
+  // Candidates and groups the last fusion space search skipped
+  std::atomic<int> prunedCandidates{0};
+  std::atomic<int> prunedGroups{0};
+
+  // Groups every strategy mapped best, the best way each mapped group
+  // materializes its fused tensors by group key and seed, and the
+  // statistics of the group searches in the last fusion space search, and
+  // their guard
+  mutable std::map<std::string, int> strategyWins;
+  mutable std::map<std::pair<std::string, uint64_t>, DNN::FusedTensorMode>
+      groupModes;
+  mutable Algorithm::SearchStatistics statistics;
+  mutable std::mutex resultsMutex;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+#ifndef JOINT_HPP
+#define JOINT_HPP
+
+#include <map>
+
+#include "algo/mcts.hpp"
+#include "partition.hpp"
+
+// Groups of every fusion candidate reached by the joint search, with one
+// analysis per group. The search runs on one thread, so the cache is filled
+// lazily from const states.
+class JointSpace {
+ public:
+  using Generator =
+      std::function<std::vector<std::shared_ptr<DNN::OperatorGroup>>(
+          const std::vector<bool>&)>;
+
+  struct Layout {
+    // Analysis and ordered dimensions of each group
+    std::vector<PartitionAnalysis> analyses;
+    std::vector<std::vector<DNN::Dimension>> dims;
+
+    // Number of mapping decisions of all groups
+    int decisions = 0;
+  };
+
+  JointSpace(const Generator _generate, int _tensorNum,
+             const std::shared_ptr<Architecture::Mesh> _mesh)
+      : generate(_generate), tensorNum(_tensorNum), mesh(_mesh) {}
+
+  // Get the groups of a fusion candidate
+  Layout& getLayout(const std::vector<bool>& fusion_bit) {
+    auto it = layouts.find(fusion_bit);
+    if (it != layouts.end()) return it->second;
+
+    Layout layout;
+    for (const auto& group : generate(fusion_bit)) {
+      auto dimensions = std::get<2>(group->getGroupInfo());
+      layout.analyses.emplace_back(group, mesh);
+      layout.dims.emplace_back(dimensions.begin(), dimensions.end());
+
+      // Spatial, temporal and sharing factors, then a loop-order pick
+      layout.decisions += 4 * dimensions.size();
+    }
+    return layouts.emplace(fusion_bit, std::move(layout)).first->second;
+  }
+
+  int getTensorNum() const noexcept { return tensorNum; }
+
+ private:
+  // Builder of the groups of a fusion candidate
+  Generator generate;
+
+  // Number of potential fusion tensors
+  int tensorNum;
+
+  std::shared_ptr<Architecture::Mesh> mesh;
+
+  // Groups by fusion candidate
+  std::map<std::vector<bool>, Layout> layouts;
+};
+
+// State of the joint fusion and mapping search. Fusion decisions come first
+// and may be taken in any order: "fuse tensor i" and "keep tensor i
+// unfused" for every undecided tensor, so the same candidate is reached
+// through many paths and merged by the transposition table. Once every
+// tensor is decided, the groups are mapped one decision at a time: the
+// spatial, temporal and sharing factor of each dimension, then the loop
+// order from the innermost dimension outwards.
+class JointState : public Algorithm::IState {
+ public:
+  JointState(const std::shared_ptr<JointSpace> _space)
+      : space(_space), fusion(_space->getTensorNum(), UNDECIDED) {}
+
+  int getActionNum() const override {
+    int undecided = std::count(fusion.begin(), fusion.end(), UNDECIDED);
+    if (undecided > 0) return 2 * undecided;
+
+    // Locate the next mapping decision within its group
+    auto& layout = space->getLayout(getFusionBits());
+    int offset = choices.size();
+    for (const auto& dims : layout.dims) {
+      int num = dims.size();
+      if (offset < 3 * num) return Cost::MAX_FACTOR;
+      if (offset < 4 * num) return 4 * num - offset;
+      offset -= 4 * num;
+    }
+    return 0;
+  }
+
+  std::shared_ptr<IState> takeAction(int action) const override {
+    auto next = std::make_shared<JointState>(*this);
+
+    // The action-th undecided tensor, fused or not
+    if (isFusionDecided()) {
+      next->choices.push_back(action);
+      return next;
+    }
+
+    for (auto& decision : next->fusion) {
+      if (decision != UNDECIDED) continue;
+      if (action < 2) {
+        decision = action;
+        break;
+      }
+      action -= 2;
+    }
+    return next;
+  }
+
+  bool isTerminated() const override {
+    if (!isFusionDecided()) return false;
+    return static_cast<int>(choices.size()) ==
+           space->getLayout(getFusionBits()).decisions;
+  }
+
+  int evaluate() const override {
+    auto& layout = space->getLayout(getFusionBits());
+    long long total = 0;
+
+    auto choice = choices.begin();
+    for (size_t g = 0; g < layout.dims.size(); g++) {
+      auto [p, o] = decode(layout.dims[g], choice);
+
+      auto& analysis = layout.analyses[g];
+      analysis.setPartitionVector(p, o);
+      if (!analysis.constraint()) return std::numeric_limits<int>::max();
+
+      // Groups run one after another
+      total += analysis.evaluate();
+    }
+
+    return static_cast<int>(
+        std::min<long long>(total, std::numeric_limits<int>::max()));
+  }
+
+  uint64_t hash() const override {
+    uint64_t h = fusion.size();
+    for (auto decision : fusion) h = Algorithm::Random::derive(h, decision + 1);
+    for (auto choice : choices) h = Algorithm::Random::derive(h, choice);
+    return h;
+  }
+
+  void print() const override {
+    std::cout << "Fusion:";
+    for (auto decision : fusion) std::cout << " " << int(decision);
+    std::cout << "\nCost: " << evaluate() << "\n";
+  }
+
+  void save(BinaryWriter& writer) const override {
+    writer.writeVector(fusion);
+    writer.writeVector(choices);
+  }
+
+  // Decode a state saved by save()
+  static std::shared_ptr<JointState> load(
+      BinaryReader& reader, const std::shared_ptr<JointSpace> space) {
+    auto state = std::make_shared<JointState>(space);
+    state->fusion = reader.readVector<int8_t>();
+    state->choices = reader.readVector<int>();
+    if (static_cast<int>(state->fusion.size()) != space->getTensorNum())
+      return nullptr;
+    return state;
+  }
+
+  // Get the fusion bits, undecided tensors unfused
+  std::vector<bool> getFusionBits() const {
+    std::vector<bool> bits(fusion.size());
+    for (size_t i = 0; i < fusion.size(); i++) bits[i] = fusion[i] == FUSED;
+    return bits;
+  }
+
+  // Decode the mapping decisions of one group, advancing the iterator past
+  // them
+  static std::pair<PartitionVector, std::vector<DNN::Dimension>> decode(
+      const std::vector<DNN::Dimension>& dims,
+      std::vector<int>::const_iterator& choice) {
+    PartitionVector p;
+    for (const auto& dim : dims) {
+      int spatial = choice[0] + 1;
+      int temporal = choice[1] + 1;
+      int sharing = choice[2] + 1;
+      p[dim] = std::make_tuple(spatial, temporal, sharing);
+      choice += 3;
+    }
+
+    // Each pick selects one of the dimensions not ordered yet
+    auto remaining = dims;
+    std::vector<DNN::Dimension> o;
+    while (!remaining.empty()) {
+      o.push_back(remaining[*choice]);
+      remaining.erase(remaining.begin() + *choice);
+      choice++;
+    }
+    return {p, o};
+  }
+
+ private:
+  static constexpr int8_t UNDECIDED = -1;
+  static constexpr int8_t FUSED = 1;
+
+  bool isFusionDecided() const noexcept {
+    return std::find(fusion.begin(), fusion.end(), UNDECIDED) == fusion.end();
+  }
+
+  std::shared_ptr<JointSpace> space;
+
+  // Decision of each potential fusion tensor
+  std::vector<int8_t> fusion;
+
+  // Mapping decisions taken so far
+  std::vector<int> choices;
+};
+
+#endif
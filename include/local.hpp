@@ -0,0 +1,211 @@
+#ifndef LOCAL_HPP
+#define LOCAL_HPP
+
+#include "mapping.hpp"
+
+// How the local search picks a move
+enum class Descent {
+  // Score every neighbour and take the best
+  Steepest,
+
+  // Take the first improving neighbour in a random order, scoring as many
+  // at once as there are workers
+  FirstImprovement
+};
+
+// Moves of a mapping to its neighbours, numbered so that each is applied
+// and undone in place: every factor of every dimension one up or one down,
+// then the swap of every two adjacent loops
+class Neighbourhood {
+ public:
+  Neighbourhood(const std::vector<DNN::Dimension>& _dims) : dims(_dims) {}
+
+  // Leave out swaps of loops that commute, which cannot change the cost
+  void setOrderSpace(const std::shared_ptr<const OrderSpace> _orders) {
+    orders = _orders;
+  }
+
+  // Get the number of moves
+  int size() const noexcept {
+    int n = dims.size();
+    return FACTOR_MOVES * n + std::max(0, n - 1);
+  }
+
+  // Apply a move; false and the mapping unchanged if it leaves a factor
+  // below one, a spatial factor above Cost::MAX_FACTOR or a tile empty, or
+  // swaps loops that commute
+  bool apply(Mapping& mapping, int move) const noexcept {
+    auto& [p, o] = mapping;
+    int factor_moves = FACTOR_MOVES * dims.size();
+    if (move >= factor_moves) {
+      auto& inner = o[move - factor_moves];
+      auto& outer = o[move - factor_moves + 1];
+      if (orders && orders->commute(p, inner, outer)) return false;
+      std::swap(inner, outer);
+      return true;
+    }
+
+    const auto& dim = dims[move / FACTOR_MOVES];
+    auto& factors = p.at(dim);
+    int& factor = get(factors, move / 2 % 3);
+    int next = factor + getStep(move);
+    if (next < 1) return false;
+
+    // Spatial factors stay in the range the cost bound assumes
+    if (move / 2 % 3 == 0 && next > Cost::MAX_FACTOR) return false;
+
+    auto [spatial, temporal, sharing] = factors;
+    if (1LL * spatial * temporal * sharing / factor * next > dim.getSize())
+      return false;
+
+    factor = next;
+    return true;
+  }
+
+  // Undo a move apply() made
+  void undo(Mapping& mapping, int move) const noexcept {
+    auto& [p, o] = mapping;
+    int factor_moves = FACTOR_MOVES * dims.size();
+    if (move >= factor_moves) {
+      std::swap(o[move - factor_moves], o[move - factor_moves + 1]);
+      return;
+    }
+
+    get(p.at(dims[move / FACTOR_MOVES]), move / 2 % 3) -= getStep(move);
+  }
+
+ private:
+  // Spatial, temporal and sharing factor, each up or down
+  static constexpr int FACTOR_MOVES = 6;
+
+  static int getStep(int move) noexcept { return move % 2 ? -1 : 1; }
+
+  static int& get(std::tuple<int, int, int>& factors, int index) noexcept {
+    if (index == 0) return std::get<0>(factors);
+    if (index == 1) return std::get<1>(factors);
+    return std::get<2>(factors);
+  }
+
+  std::vector<DNN::Dimension> dims;
+
+  // Classes of loop orders, or nullptr to try every swap
+  std::shared_ptr<const OrderSpace> orders;
+};
+
+// Polishes mappings by local search within a budget of exact evaluations
+// shared by every call. Neighbours are scored in parallel, each worker on
+// its own copy of the mapping that moves are applied to and undone on;
+// accepted moves are applied to every copy, so a descent allocates only
+// when it starts.
+class LocalSearch {
+ public:
+  LocalSearch(const std::vector<DNN::Dimension>& _dims, const MappingCost _eval,
+              const MappingViolation _cons, Descent _descent,
+              long long _budget, uint64_t seed = 0,
+              const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : neighbourhood(_dims),
+        eval(_eval),
+        cons(_cons),
+        descent(_descent),
+        budget(_budget),
+        rng(seed),
+        scheduler(_scheduler) {}
+
+  // Skip swaps of loops that commute under the mapping's partition
+  void setOrderSpace(const std::shared_ptr<const OrderSpace> orders) {
+    neighbourhood.setOrderSpace(orders);
+  }
+
+  // Descend from a feasible mapping of the given cost until no neighbour
+  // improves or the budget runs out; returns the cost of the mapping left
+  int refine(Mapping& mapping, int cost) {
+    int size = neighbourhood.size();
+    int slots = scheduler ? scheduler->getThreadNum() + 1 : 1;
+    int width = descent == Descent::Steepest ? size : slots;
+
+    std::vector<Mapping> copies(slots, mapping);
+    std::vector<int> order(size);
+    std::vector<int> costs(width);
+    for (int i = 0; i < size; i++) order[i] = i;
+
+    for (bool improved = true; improved && getRemaining() > 0;) {
+      improved = false;
+      std::shuffle(order.begin(), order.end(), rng);
+
+      // Score the neighbours a chunk at a time, in order
+      for (int start = 0; start < size && !improved; start += width) {
+        int num = static_cast<int>(std::min<long long>(
+            std::min(width, size - start), getRemaining()));
+        if (num <= 0) break;
+
+        Runtime::parallelFor(scheduler, num, [&](int i) {
+          int slot = scheduler ? scheduler->getWorkerIndex() + 1 : 0;
+          int move = order[start + i];
+          costs[i] = INVALID;
+          if (!neighbourhood.apply(copies[slot], move)) return;
+
+          costs[i] = score(copies[slot]);
+          neighbourhood.undo(copies[slot], move);
+        });
+
+        // The best of the chunk, the first on ties
+        int best = -1;
+        for (int i = 0; i < num; i++) {
+          if (costs[i] == INVALID) continue;
+          statistics.evaluations++;
+          if (costs[i] != std::numeric_limits<int>::max())
+            statistics.feasibleEvaluations++;
+          if (costs[i] < cost && (best < 0 || costs[i] < costs[best]))
+            best = i;
+        }
+        if (best < 0) continue;
+
+        int move = order[start + best];
+        neighbourhood.apply(mapping, move);
+        for (auto& copy : copies) neighbourhood.apply(copy, move);
+        cost = costs[best];
+        improved = true;
+      }
+    }
+    return cost;
+  }
+
+  // Get the evaluations left in the budget
+  long long getRemaining() const noexcept {
+    return budget - statistics.evaluations;
+  }
+
+  // Get the evaluations spent so far
+  auto getStatistics() const noexcept { return statistics; }
+
+ private:
+  // Cost of a move that leaves the factor range
+  static constexpr int INVALID = -1;
+
+  // Cost of a feasible mapping, the worst cost otherwise
+  int score(const Mapping& mapping) const {
+    const auto& [p, o] = mapping;
+    if (cons(p, o) > 0) return std::numeric_limits<int>::max();
+    return eval(p, o);
+  }
+
+  Neighbourhood neighbourhood;
+
+  MappingCost eval;
+  MappingViolation cons;
+
+  Descent descent;
+
+  // Exact evaluations of every call together
+  long long budget;
+
+  // Random stream of the move order
+  Algorithm::Random rng;
+
+  // Scheduler of the evaluations, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  Algorithm::SearchStatistics statistics;
+};
+
+#endif
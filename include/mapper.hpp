@@ -1,14 +1,66 @@
 #ifndef MAPPER_HPP
 #define MAPPER_HPP
 
-#include "mapping.hpp"
+#include "strategy.hpp"
 
 class Mapper {
  public:
-  Mapper(const std::shared_ptr<PartitionAnalysis> _analysis)
-      : analysis(_analysis) {}
+  Mapper(const std::shared_ptr<PartitionAnalysis> _analysis,
+         uint64_t _seed = 0,
+         const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : analysis(_analysis), seed(_seed), scheduler(_scheduler) {}
 
-  void search() const noexcept {
+  // Prescreen candidates with a surrogate, evaluating only the top fraction
+  void setSurrogateFraction(double _surrogateFraction) noexcept {
+    surrogateFraction = _surrogateFraction;
+  }
+
+  // Choose how the GA treats mappings that overflow a core's buffer
+  void setConstraintHandling(Algorithm::ConstraintHandling _handling,
+                             double _penalty = 1.0) noexcept {
+    handling = _handling;
+    penalty = _penalty;
+  }
+
+  // Seed the search with known mappings, e.g. of neighbouring shapes, and
+  // run a smaller population for fewer generations
+  void setWarmStart(const std::vector<Mapping>& _warmStart, int _population,
+                    int _generations) {
+    warmStart = _warmStart;
+    population = _population;
+    generations = _generations;
+  }
+
+  // Polish mappings by local search within `budget` exact evaluations: the
+  // `elites` cheapest individuals of every generation of the genetic
+  // algorithm, then the final result with what is left. A budget of 0
+  // disables it.
+  void setLocalSearch(Descent _descent, long long _budget,
+                      int _elites = 0) noexcept {
+    descent = _descent;
+    localBudget = _budget;
+    elites = _elites;
+  }
+
+  // Keep loop orders canonical, so that the search draws and swaps only
+  // orders of distinct cost classes, and try every canonical order of the
+  // best partition when it has at most `exhaustive` of them (0 never does)
+  void setCanonicalOrders(bool _canonical, long long _exhaustive = 0) noexcept {
+    canonical = _canonical;
+    exhaustive = _exhaustive;
+  }
+
+  // Race the named strategies of the registry under the budget of the
+  // genetic algorithm instead of running it alone
+  void setPortfolio(const std::vector<std::string>& _portfolio) {
+    portfolio = _portfolio;
+  }
+
+  // Snapshot the search to files prefixed by `path` and resume from them;
+  // a search that is not cancelled removes them once it completes
+  void setCheckpoint(const std::string& path) { checkpointPath = path; }
+
+  void search() noexcept {
     auto group = analysis->getOperatorGroup();
     auto [operators, tensors, dimensions, internalTensors, externalTensors] =
         group->getGroupInfo();
@@ -16,24 +68,216 @@ class Mapper {
     auto dims =
         std::vector<DNN::Dimension>(dimensions.begin(), dimensions.end());
 
-    auto eval = [&](PartitionVector p, std::vector<DNN::Dimension> o) -> int {
-      analysis->setPartitionVector(p, o);
-      return analysis->evaluate();
+    // Evaluation mutates the analysis, so every worker gets its own copy and
+    // slot 0 serves threads outside the pool
+    int slots = scheduler ? scheduler->getThreadNum() + 1 : 1;
+    std::vector<PartitionAnalysis> analyses(slots, *analysis);
+
+    auto local = [&]() -> PartitionAnalysis & {
+      return analyses[scheduler ? scheduler->getWorkerIndex() + 1 : 0];
+    };
+
+    auto eval = [&](const PartitionVector &p,
+                    const std::vector<DNN::Dimension> &o) -> int {
+      auto &a = local();
+      a.setPartitionVector(p, o);
+      return a.evaluate();
     };
 
-    auto cons = [&](PartitionVector p, std::vector<DNN::Dimension> o) -> bool {
-      analysis->setPartitionVector(p, o);
-      return analysis->constraint();
+    auto cons = [&](const PartitionVector &p,
+                    const std::vector<DNN::Dimension> &o) -> double {
+      auto &a = local();
+      a.setPartitionVector(p, o);
+      return a.getViolation();
     };
 
-    auto ga = std::make_shared<Algorithm::GeneticAlgorithm>(30, 50, 0.3f, 0.7f);
+    std::shared_ptr<const OrderSpace> orders;
+    if (canonical) orders = std::make_shared<OrderSpace>(analysis->getLayout());
+
+    auto local_search =
+        localBudget > 0
+            ? std::make_shared<LocalSearch>(dims, eval, cons, descent,
+                                            localBudget, seed, scheduler)
+            : nullptr;
+    if (local_search) local_search->setOrderSpace(orders);
+
+    StrategyContext context;
+    context.dims = dims;
+    context.eval = eval;
+    context.cons = cons;
+    context.seed = seed;
+    context.scheduler = scheduler;
+    context.token = token;
+    context.handling = handling;
+    context.penalty = penalty;
+    context.surrogateFraction = surrogateFraction;
+    context.warmStart = warmStart;
+    context.population = population;
+    context.generations = generations;
+    context.localSearch = local_search;
+    context.elites = elites;
+    context.orders = orders;
+    context.checkpointPath = checkpointPath;
+
+    if (portfolio.empty()) {
+      // The genetic algorithm alone, run to its last generation
+      auto ga = StrategyRegistry::getInstance().create("genetic", context);
+      ga->advance(std::numeric_limits<long long>::max());
+
+      statistics = ga->getStatistics();
+      feasibilityRatios = ga->getFeasibilityRatios();
+      bestCost = ga->getBestCost();
+      bestMapping = ga->getBestMapping();
+      winner = "genetic";
+      results.clear();
+    } else {
+      Portfolio race(portfolio, context);
+      race.run();
+
+      statistics = race.getStatistics();
+      feasibilityRatios = race.getFeasibilityRatios();
+      bestCost = race.getBestCost();
+      bestMapping = race.getBestMapping();
+      winner = race.getWinner();
+      results = race.getResults();
+    }
+
+    // The strategies wrote their last snapshots when destroyed above
+    if (!checkpointPath.empty() && !(token && token->isCancelled())) {
+      auto names = portfolio.empty() ? std::vector<std::string>{"genetic"}
+                                     : portfolio;
+      names.push_back("portfolio");
+      for (const auto& name : names)
+        std::remove((checkpointPath + "." + name).c_str());
+    }
+
+    // Every class of loop order of the best partition, if there are few
+    if (orders && exhaustive > 0 && !bestMapping.second.empty()) {
+      const auto &p = bestMapping.first;
+      auto candidates = orders->enumerate(p, exhaustive + 1);
+      int num = candidates.size();
+      if (num <= exhaustive) {
+        std::vector<int> costs(num);
+        Runtime::parallelFor(scheduler, num, [&](int i) {
+          costs[i] = cons(p, candidates[i]) > 0
+                         ? std::numeric_limits<int>::max()
+                         : eval(p, candidates[i]);
+        });
+
+        for (int i = 0; i < num; i++) {
+          statistics.evaluations++;
+          if (costs[i] == std::numeric_limits<int>::max()) continue;
+          statistics.feasibleEvaluations++;
+          if (costs[i] >= bestCost) continue;
+          bestCost = costs[i];
+          bestMapping.second = candidates[i];
+        }
+      }
+    }
+
+    if (local_search) {
+      if (!bestMapping.second.empty())
+        bestCost = local_search->refine(bestMapping, bestCost);
+
+      auto polished = local_search->getStatistics();
+      statistics.evaluations += polished.evaluations;
+      statistics.feasibleEvaluations += polished.feasibleEvaluations;
+    }
 
-    ga->initialize<PartitionIndividual>(dims, eval, cons);
-    ga->run();
+    // Report the factors the cost model applied to resident dimensions
+    if (!bestMapping.second.empty())
+      for (const auto &dim : group->getResidentDimensions())
+        bestMapping.first[dim] = std::make_tuple(1, 1, 1);
   }
 
+  // Stop the search once the token is cancelled
+  void setCancellationToken(
+      const std::shared_ptr<Runtime::CancellationToken> _token) noexcept {
+    token = _token;
+  }
+
+  // Get the best cost of the last search
+  auto getBestCost() const noexcept { return bestCost; }
+
+  // Get the best mapping of the last search
+  const auto& getBestMapping() const noexcept { return bestMapping; }
+
+  // Get the feasible fraction of every generation of the last search
+  const auto& getFeasibilityRatios() const noexcept {
+    return feasibilityRatios;
+  }
+
+  // Get the statistics of the last search
+  auto getStatistics() const noexcept { return statistics; }
+
+  // Get the strategy that found the best mapping of the last search
+  const auto& getWinner() const noexcept { return winner; }
+
+  // Get the outcome of every strategy of the last portfolio search
+  const auto& getStrategyResults() const noexcept { return results; }
+
  private:
   std::shared_ptr<PartitionAnalysis> analysis;
+
+  // Seed of the search
+  uint64_t seed;
+
+  // Fraction of candidates evaluated exactly (0 disables the surrogate)
+  double surrogateFraction = 0.0;
+
+  // Statistics of the last search
+  Algorithm::SearchStatistics statistics;
+
+  // Feasible fraction of every generation of the last search
+  std::vector<double> feasibilityRatios;
+
+  // Treatment of mappings that overflow a core's buffer
+  Algorithm::ConstraintHandling handling =
+      Algorithm::ConstraintHandling::Repair;
+
+  // Penalty factor of ConstraintHandling::Penalty
+  double penalty = 1.0;
+
+  // Best cost of the last search
+  int bestCost = std::numeric_limits<int>::max();
+
+  // Best mapping of the last search
+  Mapping bestMapping;
+
+  // Mappings seeding the population
+  std::vector<Mapping> warmStart;
+
+  // Local search of the elites and the final result, its budget of exact
+  // evaluations (0 disables it) and the number of elites
+  Descent descent = Descent::Steepest;
+  long long localBudget = 0;
+  int elites = 0;
+
+  // Whether loop orders are kept canonical, and the most canonical orders
+  // of the best partition tried one by one
+  bool canonical = false;
+  long long exhaustive = 0;
+
+  // Strategies raced by the search, the genetic algorithm alone if empty
+  std::vector<std::string> portfolio;
+
+  // Strategy that found the best mapping, and the outcome of every
+  // strategy of a portfolio
+  std::string winner;
+  std::vector<StrategyResult> results;
+
+  // Size of the population and number of generations
+  int population = 30;
+  int generations = 50;
+
+  // Scheduler of the evaluations, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Cancellation of the search
+  std::shared_ptr<Runtime::CancellationToken> token;
+
+  // Prefix of the snapshot files of the strategies, empty to disable
+  std::string checkpointPath;
 };
 
 #endif
\ No newline at end of file
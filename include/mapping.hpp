@@ -1,49 +1,78 @@
 #ifndef MAPPING_HPP
 #define MAPPING_HPP
 
+#include <cmath>
 #include <functional>
 #include <limits>
 
 #include "algo/genetic.hpp"
-#include "partition.hpp"
+#include "order.hpp"
+
+// Partition vector and loop order of one group
+using Mapping = std::pair<PartitionVector, std::vector<DNN::Dimension>>;
+
+// Cost and constraint violation of a mapping of one group
+using MappingCost = std::function<int(const PartitionVector&,
+                                      const std::vector<DNN::Dimension>&)>;
+using MappingViolation = std::function<double(
+    const PartitionVector&, const std::vector<DNN::Dimension>&)>;
 
 class PartitionIndividual : public Algorithm::IIndividual {
  public:
   PartitionIndividual(
-      const std::vector<DNN::Dimension> _dims,
-      const std::function<int(PartitionVector, std::vector<DNN::Dimension>)>
-          _eval,
-      const std::function<int(PartitionVector, std::vector<DNN::Dimension>)>
-          _cons)
-      : dims(_dims), evaluate(_eval), constraint(_cons) {
-    randomize();
+      Algorithm::Random& rng, const std::vector<DNN::Dimension> _dims,
+      const MappingCost _eval, const MappingViolation _cons,
+      const std::shared_ptr<const OrderSpace> _orders = nullptr)
+      : dims(_dims), evaluate(_eval), constraint(_cons), orders(_orders) {
+    randomize(rng);
   }
 
-  void randomize() {
+  void randomize(Algorithm::Random& rng) {
     // Initialize with random partition and order
     p.clear();
     o.clear();
 
     for (auto dim : dims) {
-      p[dim] = std::make_tuple(rand() % 4 + 1, rand() % 4 + 1, rand() % 4 + 1);
+      p[dim] = std::make_tuple(drawFactor(rng), drawFactor(rng),
+                               drawFactor(rng));
       o.push_back(dim);
     }
-    std::random_shuffle(o.begin(), o.end());
+    std::shuffle(o.begin(), o.end(), rng);
+    canonicalise();
+  }
+
+  // Start from a given mapping instead of a random one
+  void setMapping(const Mapping& mapping) {
+    std::tie(p, o) = mapping;
   }
 
-  int fitness() const override {
-    if (constraint(p, o)) return std::numeric_limits<int>::max();
+  // Get the partition vector and loop order
+  Mapping getMapping() const { return {p, o}; }
+
+  int fitness() const override { return evaluate(p, o); }
+
+  double violation() const override { return constraint(p, o); }
 
-    return evaluate(p, o);
+  void repair() override {
+    shrink();
+    canonicalise();
   }
 
-  void mutate() override {
+  std::shared_ptr<IIndividual> decode() const override {
+    auto decoded = std::make_shared<PartitionIndividual>(*this);
+    decoded->repair();
+    return decoded;
+  }
+
+  void mutate(Algorithm::Random& rng) override {
     if (p.empty()) return;
-    auto it = p.begin();
-    std::advance(it, rand() % p.size());
-    int a = rand() % 4 + 1, b = rand() % 4 + 1, c = rand() % 4 + 1;
-    it->second = std::make_tuple(a, b, c);
-    std::random_shuffle(o.begin(), o.end());
+    // Pick through the ordered dims, the map's iteration order is not stable
+    auto& factors = p.at(dims[rng.uniformInt(dims.size())]);
+    int a = drawFactor(rng);
+    int b = drawFactor(rng);
+    int c = drawFactor(rng);
+    factors = std::make_tuple(a, b, c);
+    reorder(rng);
   }
 
   std::shared_ptr<IIndividual> clone() const override {
@@ -52,13 +81,14 @@ class PartitionIndividual : public Algorithm::IIndividual {
   }
 
   std::shared_ptr<IIndividual> crossover(
-      const std::shared_ptr<IIndividual>& other) const override {
+      const std::shared_ptr<IIndividual>& other,
+      Algorithm::Random& rng) const override {
     auto other_part = std::dynamic_pointer_cast<PartitionIndividual>(other);
-    auto child = std::make_shared<PartitionIndividual>();
+    auto child = std::make_shared<PartitionIndividual>(*this);
 
     // Uniform crossover
     for (const auto& dim : dims) {
-      if (rand() % 2) {
+      if (rng.uniformInt(2)) {
         child->p[dim] = this->p.at(dim);
       } else {
         child->p[dim] = other_part->p.at(dim);
@@ -66,11 +96,63 @@ class PartitionIndividual : public Algorithm::IIndividual {
     }
 
     child->o = this->o;
-    if (rand() % 2) std::random_shuffle(child->o.begin(), child->o.end());
+    if (rng.uniformInt(2)) child->reorder(rng);
+    child->canonicalise();
 
     return child;
   }
 
+  std::vector<double> features() const override {
+    std::vector<double> f;
+    f.reserve(dims.size() * 5);
+
+    for (const auto& dim : dims) {
+      auto [spatial, temporal, sharing] = p.at(dim);
+      int tile = std::max(1, dim.getSize() / (spatial * temporal * sharing));
+
+      // Per-dimension factors and tile size on a log scale
+      f.push_back(std::log2(spatial));
+      f.push_back(std::log2(temporal));
+      f.push_back(std::log2(sharing));
+      f.push_back(std::log2(tile));
+
+      // Loop-order position, normalised to [0, 1] from inner to outer
+      auto pos = std::find(o.begin(), o.end(), dim) - o.begin();
+      f.push_back(o.size() > 1 ? 1.0 * pos / (o.size() - 1) : 0.0);
+    }
+
+    return f;
+  }
+
+  void save(BinaryWriter& writer) const override {
+    for (const auto& dim : dims) {
+      auto [spatial, temporal, sharing] = p.at(dim);
+      writer.write(spatial);
+      writer.write(temporal);
+      writer.write(sharing);
+    }
+
+    // Loop order as indices into dims
+    for (const auto& dim : o)
+      writer.write<uint32_t>(std::find(dims.begin(), dims.end(), dim) -
+                             dims.begin());
+  }
+
+  void load(BinaryReader& reader) override {
+    for (const auto& dim : dims) {
+      int spatial = reader.read<int>();
+      int temporal = reader.read<int>();
+      int sharing = reader.read<int>();
+      p[dim] = std::make_tuple(spatial, temporal, sharing);
+    }
+
+    o.clear();
+    for (size_t i = 0; i < dims.size(); i++) {
+      auto index = reader.read<uint32_t>();
+      o.push_back(dims[std::min<size_t>(index, dims.size() - 1)]);
+    }
+  }
+
   void print() const override {
     std::cout << "Fitness: " << fitness() << "\n";
     for (auto dim : o) {
@@ -82,20 +164,74 @@ class PartitionIndividual : public Algorithm::IIndividual {
   }
 
  private:
+  // Draw a factor from 1 to the largest the cost bound assumes
+  static int drawFactor(Algorithm::Random& rng) {
+    return rng.uniformInt(Cost::MAX_FACTOR) + 1;
+  }
+
+  // Shrink tiles until they fit, halving the largest tile each step by
+  // doubling the temporal factor of its dimension
+  void shrink() {
+    while (constraint(p, o) > 0) {
+      const DNN::Dimension* largest = nullptr;
+      int largest_tile = 1;
+
+      for (const auto& dim : dims) {
+        auto [spatial, temporal, sharing] = p.at(dim);
+        int tile = dim.getSize() / (spatial * temporal * sharing);
+        if (tile <= largest_tile) continue;
+
+        largest = &dim;
+        largest_tile = tile;
+      }
+
+      // Every tile is a single element
+      if (!largest) return;
+      std::get<1>(p.at(*largest)) *= 2;
+    }
+  }
+
+  // Draw a new loop order; with an order space, one of another class than
+  // the current order's if a few draws find one
+  void reorder(Algorithm::Random& rng) {
+    if (!orders) {
+      std::shuffle(o.begin(), o.end(), rng);
+      return;
+    }
+
+    auto current = orders->canonicalise(p, o);
+    for (int i = 0; i < REORDER_DRAWS; i++) {
+      std::shuffle(o.begin(), o.end(), rng);
+      o = orders->canonicalise(p, o);
+      if (o != current) return;
+    }
+  }
+
+  // Replace the loop order by the canonical one of its class
+  void canonicalise() {
+    if (orders) o = orders->canonicalise(p, o);
+  }
+
+  // Draws of reorder() before it settles for the current class
+  static constexpr int REORDER_DRAWS = 8;
+
   // Dimensions
   std::vector<DNN::Dimension> dims;
 
   // Evaluation function
-  std::function<int(PartitionVector, std::vector<DNN::Dimension>)> evaluate;
+  MappingCost evaluate;
 
-  // Constraint function
-  std::function<int(PartitionVector, std::vector<DNN::Dimension>)> constraint;
+  // Constraint function, returning the relative violation
+  MappingViolation constraint;
 
   // Partition vector
   PartitionVector p;
 
   // Ordered dimensions
   std::vector<DNN::Dimension> o;
+
+  // Classes of loop orders the search keeps canonical, or nullptr
+  std::shared_ptr<const OrderSpace> orders;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,299 @@
+#ifndef MULTICHIP_HPP
+#define MULTICHIP_HPP
+
+#include "arch/system.hpp"
+#include "mapper.hpp"
+#include "stages.hpp"
+
+// What a placement of groups on the chips of a system minimises
+enum class SystemObjective {
+  // Cycles of one micro-batch through every stage
+  Latency,
+
+  // Cycles between two micro-batches in steady state
+  Throughput
+};
+
+// Placement of the groups of one fusion candidate on the chips of a system
+struct SystemReport {
+  // First group and chips of each stage; a stage runs its groups up to the
+  // first of the next stage
+  std::vector<int> firstGroups;
+  std::vector<int> chips;
+
+  // Dimension every group is split along over the chips of its stage,
+  // empty on one chip
+  std::vector<std::string> splits;
+
+  // Cycles of each stage per micro-batch, its collectives included
+  std::vector<int> stageCycles;
+
+  // Cycles handing the outputs of each stage to later stages
+  std::vector<int> transferCycles;
+
+  // Cycles between two micro-batches in steady state
+  long long interval = std::numeric_limits<int>::max();
+
+  // Cycles of one micro-batch from the first stage to the last
+  long long latency = std::numeric_limits<int>::max();
+
+  // Cycles of all micro-batches, including pipeline fill and drain
+  long long makespan = std::numeric_limits<int>::max();
+
+  // Number of micro-batches
+  int microBatches = 1;
+
+  // Check if every stage got chips and a feasible mapping
+  bool isFeasible() const noexcept {
+    return interval < std::numeric_limits<int>::max();
+  }
+
+  // Steady-state micro-batches per cycle
+  double getThroughput() const noexcept {
+    return isFeasible() ? 1.0 / interval : 0.0;
+  }
+};
+
+// Places consecutive groups on consecutive chips as pipeline stages, and
+// splits every group of a stage over the stage's chips along one dimension
+// (tensor parallelism). Each split of each group is mapped on one chip by
+// the per-group mapper, and the collectives joining the shards run over the
+// inter-chip links: outputs later groups consume are all-reduced if the
+// split leaves partial sums and all-gathered if it leaves shards, the
+// others only reduced to shards. A dynamic program
+// over groups and chips then picks the stages and their chips. Tensors
+// consumed by later stages cross the link after every stage in between.
+class SystemPlanner {
+ public:
+  SystemPlanner(
+      const std::shared_ptr<const DNN::DAG> _operatorGraph,
+      const std::vector<std::shared_ptr<DNN::OperatorGroup>> _groups,
+      const std::shared_ptr<Architecture::System> _system, uint64_t _seed = 0,
+      const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : operatorGraph(_operatorGraph),
+        groups(_groups),
+        system(_system),
+        seed(_seed),
+        scheduler(_scheduler) {}
+
+  // Set the number of micro-batches streamed through the stages
+  void setMicroBatches(int _microBatches) noexcept {
+    microBatches = std::max(1, _microBatches);
+  }
+
+  // Set what the placement minimises, the other breaking ties
+  void setObjective(SystemObjective _objective) noexcept {
+    objective = _objective;
+  }
+
+  SystemReport plan() const {
+    SystemReport report;
+    report.microBatches = microBatches;
+
+    int group_num = groups.size();
+    int chips = system->chipNum;
+    if (group_num == 0 || chips < 1) return report;
+
+    // Best split of each group over 1 to `chips` chips
+    auto splits = splitGroups();
+
+    // Cycles of the tensors crossing the link after each group
+    std::vector<int> cuts(group_num, 0);
+    for (int g = 0; g + 1 < group_num; g++) cuts[g] = getCutCycles(g);
+
+    // A stage runs its groups one after another, then hands its outputs on
+    auto plan = planStages(
+        group_num, chips, group_num,
+        [&](int first, int last, int w) -> StageScore {
+          long long stage = 0;
+          for (int g = first; g < last; g++) {
+            if (splits[g][w].cycles == std::numeric_limits<int>::max())
+              return NO_STAGES;
+            stage += splits[g][w].cycles;
+          }
+          long long transfer = cuts[last - 1];
+          return {std::max(stage, transfer), stage + transfer};
+        },
+        [&](const StageScore& a, const StageScore& b) {
+          return isBetter(a, b);
+        });
+    if (!plan.isFeasible()) return report;
+    auto [interval, latency] = plan.score;
+
+    report.firstGroups = plan.firstItems;
+    report.chips = plan.units;
+    report.splits.resize(group_num);
+    for (size_t i = 0; i < plan.firstItems.size(); i++) {
+      int first = plan.firstItems[i];
+      int last = i + 1 < plan.firstItems.size() ? plan.firstItems[i + 1]
+                                                : group_num;
+      int w = plan.units[i];
+
+      long long stage = 0;
+      for (int g = first; g < last; g++) {
+        stage += splits[g][w].cycles;
+        report.splits[g] = splits[g][w].dim;
+      }
+      report.stageCycles.push_back(static_cast<int>(stage));
+      report.transferCycles.push_back(cuts[last - 1]);
+    }
+
+    report.interval = interval;
+    report.latency = latency;
+    report.makespan = latency + (microBatches - 1) * interval;
+    return report;
+  }
+
+ private:
+  // Cycles of a group on some chips and the dimension it is split along
+  struct Split {
+    int cycles = std::numeric_limits<int>::max();
+    std::string dim;
+  };
+
+  // Map every split of every group and keep the best per chip count
+  std::vector<std::vector<Split>> splitGroups() const {
+    int chips = system->chipNum;
+
+    // Every group whole on one chip, and along each of its dimensions on
+    // every other chip count that divides it
+    struct Candidate {
+      int group;
+      int chips;
+      DNN::Dimension dim;
+    };
+    std::vector<Candidate> candidates;
+    for (size_t g = 0; g < groups.size(); g++) {
+      const auto& dims = std::get<2>(groups[g]->getGroupInfo());
+      candidates.push_back({static_cast<int>(g), 1, *dims.begin()});
+
+      for (const auto& dim : dims)
+        for (int w = 2; w <= chips; w++)
+          if (dim.getSize() % w == 0)
+            candidates.push_back({static_cast<int>(g), w, dim});
+    }
+
+    std::vector<int> costs(candidates.size());
+    Runtime::parallelFor(scheduler, candidates.size(), [&](int i) {
+      const auto& [g, w, dim] = candidates[i];
+      costs[i] = mapSplit(g, dim, w, Algorithm::Random::derive(seed, i));
+    });
+
+    std::vector<std::vector<Split>> splits(groups.size(),
+                                           std::vector<Split>(chips + 1));
+    for (size_t i = 0; i < candidates.size(); i++) {
+      const auto& [g, w, dim] = candidates[i];
+      if (costs[i] >= splits[g][w].cycles) continue;
+      splits[g][w] = {costs[i], w > 1 ? dim.getName() : ""};
+    }
+    return splits;
+  }
+
+  // Map group g split along a dimension over w chips and return the cost of
+  // one shard plus the collectives joining them
+  int mapSplit(int g, const DNN::Dimension& dim, int w,
+               uint64_t split_seed) const {
+    long long collectives = w > 1 ? getJoinCycles(g, dim, w) : 0;
+    if (collectives < 0) return std::numeric_limits<int>::max();
+
+    auto group = groups[g];
+    if (w > 1) {
+      DNN::Shape shape{{dim.getName(), dim.getSize() / w}};
+      group = group->resize(operatorGraph->resize(shape), shape);
+    }
+
+    auto chip = std::make_shared<Architecture::Mesh>(system->chip);
+    auto analysis = std::make_shared<PartitionAnalysis>(group, chip);
+    Mapper mapper(analysis, split_seed, scheduler);
+    mapper.search();
+
+    int cost = mapper.getBestCost();
+    if (cost == std::numeric_limits<int>::max()) return cost;
+    return static_cast<int>(std::min<long long>(
+        cost + collectives, std::numeric_limits<int>::max() - 1));
+  }
+
+  // Cycles of the collectives joining the shards of group g split along a
+  // dimension over w chips, or -1 if partial sums or a softmax axis would
+  // be split within the group
+  long long getJoinCycles(int g, const DNN::Dimension& dim, int w) const {
+    const auto& internal = std::get<3>(groups[g]->getGroupInfo());
+    auto network = system->getChipNetwork();
+    long long cycles = 0;
+
+    for (const auto& op : std::get<0>(groups[g]->getGroupInfo())) {
+      if (op.getAxis() && *op.getAxis() == dim) return -1;
+      bool reduced = op.getReductionDimensions().count(dim);
+
+      for (const auto& tensor : op.getOutputs()) {
+        if (internal.count(tensor)) {
+          if (reduced) return -1;
+          continue;
+        }
+
+        const auto& dims = tensor.getDimensions();
+        bool whole = isConsumedAfter(groups, g, tensor);
+        long long bytes = getTensorBytes(*groups[g], tensor);
+        if (reduced)
+          cycles += Cost::pickCollective(bytes, w, whole, network).second;
+        else if (whole && std::count(dims.begin(), dims.end(), dim))
+          cycles += Cost::getAllGatherCycles(bytes, w, network);
+      }
+    }
+    return cycles;
+  }
+
+  // Cycles moving the tensors groups up to g produce and later groups
+  // consume over one inter-chip link
+  int getCutCycles(int g) const {
+    long long bytes = 0;
+    std::unordered_set<DNN::Tensor, DNN::TensorHash> seen;
+
+    for (int p = 0; p <= g; p++) {
+      for (const auto& op : std::get<0>(groups[p]->getGroupInfo())) {
+        for (const auto& tensor : op.getOutputs()) {
+          if (seen.count(tensor) || !isConsumedAfter(groups, g, tensor))
+            continue;
+          seen.insert(tensor);
+          bytes += getTensorBytes(*groups[p], tensor);
+        }
+      }
+    }
+    if (bytes == 0) return 0;
+
+    long long cycles = system->chipLatency + bytes / system->chipBandwidth;
+    return static_cast<int>(
+        std::min<long long>(cycles, std::numeric_limits<int>::max()));
+  }
+
+  // Compare scores by the objective first
+  bool isBetter(const StageScore& a, const StageScore& b) const noexcept {
+    if (objective == SystemObjective::Throughput) return a < b;
+    if (a.first == std::numeric_limits<long long>::max()) return false;
+    if (b.first == std::numeric_limits<long long>::max()) return true;
+    return std::make_pair(a.second, a.first) <
+           std::make_pair(b.second, b.first);
+  }
+
+  // Graph the groups belong to, resized for split groups
+  std::shared_ptr<const DNN::DAG> operatorGraph;
+
+  // Groups in execution order
+  std::vector<std::shared_ptr<DNN::OperatorGroup>> groups;
+
+  std::shared_ptr<Architecture::System> system;
+
+  // Seed of the group mappings
+  uint64_t seed;
+
+  // Number of micro-batches
+  int microBatches = 1;
+
+  // What the placement minimises
+  SystemObjective objective = SystemObjective::Throughput;
+
+  // Scheduler of the group mappings, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+};
+
+#endif
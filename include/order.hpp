@@ -0,0 +1,156 @@
+#ifndef ORDER_HPP
+#define ORDER_HPP
+
+#include "partition.hpp"
+
+// Loop orders of a group up to what the cost kernel can tell apart. Two
+// adjacent loops commute under a partition if swapping them changes no
+// term that depends on the order: the loops a tensor is re-streamed across,
+// the innermost advancing loop and the tiles a stored fused tensor holds.
+// Orders that differ by swaps of commuting neighbours cost the same; the
+// canonical order of each class is its smallest by dimension index, from
+// the innermost loop outwards.
+class OrderSpace {
+ public:
+  OrderSpace(const std::shared_ptr<const Cost::Layout> _layout)
+      : layout(_layout) {}
+
+  // Check if two adjacent loops commute under a partition
+  bool commute(const PartitionVector& p, const DNN::Dimension& x,
+               const DNN::Dimension& y) const {
+    int i = layout->getIndex(x);
+    int j = layout->getIndex(y);
+    return commute(i, getLoop(p, i), j, getLoop(p, j));
+  }
+
+  // Get the canonical order of the class of an order under a partition
+  std::vector<DNN::Dimension> canonicalise(
+      const PartitionVector& p, const std::vector<DNN::Dimension>& o) const {
+    auto loops = getLoops(p);
+    std::vector<int> rest;
+    for (const auto& dim : o) rest.push_back(layout->getIndex(dim));
+
+    // Repeatedly take the smallest loop that commutes with every loop
+    // still inside it
+    std::vector<DNN::Dimension> canonical;
+    while (!rest.empty()) {
+      size_t pick = 0;
+      for (size_t k = 1; k < rest.size(); k++) {
+        if (rest[k] > rest[pick]) continue;
+
+        bool free = true;
+        for (size_t l = 0; l < k && free; l++)
+          free = commute(rest[l], loops[rest[l]], rest[k], loops[rest[k]]);
+        if (free) pick = k;
+      }
+
+      canonical.push_back(layout->dims[rest[pick]]);
+      rest.erase(rest.begin() + pick);
+    }
+    return canonical;
+  }
+
+  // Get the canonical orders of every class under a partition, at most
+  // `limit` of them
+  std::vector<std::vector<DNN::Dimension>> enumerate(const PartitionVector& p,
+                                                     size_t limit) const {
+    auto loops = getLoops(p);
+    std::vector<std::vector<DNN::Dimension>> orders;
+    std::vector<int> prefix;
+    extend(loops, prefix, 0, limit, orders);
+    return orders;
+  }
+
+ private:
+  // Temporal and sharing factor of a loop
+  struct Loop {
+    int temporal;
+    int sharing;
+
+    int getTrips() const noexcept { return temporal * sharing; }
+
+    // A loop multiplying both traffic terms by one
+    bool isNeutral() const noexcept { return temporal == 1 && sharing == 2; }
+  };
+
+  // Factors of a loop as the kernel applies them
+  Loop getLoop(const PartitionVector& p, int i) const {
+    if (layout->residentMask >> i & 1) return {1, 1};
+    auto [s, t, h] = p.at(layout->dims[i]);
+    return {t, h};
+  }
+
+  std::vector<Loop> getLoops(const PartitionVector& p) const {
+    std::vector<Loop> loops;
+    for (size_t i = 0; i < layout->dims.size(); i++)
+      loops.push_back(getLoop(p, i));
+    return loops;
+  }
+
+  bool commute(int x, Loop lx, int y, Loop ly) const noexcept {
+    if (x == y) return true;
+    bool advancing = lx.getTrips() > 1 && ly.getTrips() > 1;
+
+    // A tensor over one of the loops is re-streamed across the other when
+    // it is outside, unless that loop does not re-run its operator or
+    // multiplies by one
+    for (const auto& access : layout->accesses) {
+      bool in_x = access.mask >> x & 1;
+      bool in_y = access.mask >> y & 1;
+      if (in_x == in_y || access.fused) continue;
+
+      int other = in_x ? y : x;
+      auto loop = in_x ? ly : lx;
+      if (access.steps >> other & 1 && !loop.isNeutral()) return false;
+    }
+
+    // Either loop may be the innermost advancing one, which decides the
+    // buffers carried between operators, and a stored fused tensor holds
+    // the tiles of its own loops inside the outermost one it is revisited
+    // across. Neither can change if only one advances or every buffer
+    // indexes both or neither.
+    if (!advancing || layout->operatorMasks.size() < 2) return true;
+    for (const auto& buffer : layout->buffers) {
+      if (buffer.access < 0) continue;
+      const auto& access = layout->accesses[buffer.access];
+      if ((access.mask >> x & 1) != (access.mask >> y & 1)) return false;
+    }
+    return true;
+  }
+
+  // Extend a canonical prefix, from the innermost loop outwards, by every
+  // loop that keeps it canonical: one that cannot move inside a larger
+  // loop it commutes with
+  void extend(const std::vector<Loop>& loops, std::vector<int>& prefix,
+              uint64_t used, size_t limit,
+              std::vector<std::vector<DNN::Dimension>>& orders) const {
+    int n = layout->dims.size();
+    if (orders.size() >= limit) return;
+    if (static_cast<int>(prefix.size()) == n) {
+      std::vector<DNN::Dimension> order;
+      for (auto i : prefix) order.push_back(layout->dims[i]);
+      orders.push_back(order);
+      return;
+    }
+
+    for (int c = 0; c < n; c++) {
+      if (used >> c & 1) continue;
+
+      bool canonical = true;
+      for (int k = prefix.size() - 1; k >= 0 && canonical; k--) {
+        int d = prefix[k];
+        if (!commute(d, loops[d], c, loops[c])) break;
+        canonical = d < c;
+      }
+      if (!canonical) continue;
+
+      prefix.push_back(c);
+      extend(loops, prefix, used | uint64_t(1) << c, limit, orders);
+      prefix.pop_back();
+    }
+  }
+
+  std::shared_ptr<const Cost::Layout> layout;
+};
+
+#endif
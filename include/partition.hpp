@@ -1,27 +1,53 @@
 #ifndef PARTITION_HPP
 #define PARTITION_HPP
 
-#include "arch/mesh.hpp"
-// spatial * temporal * sharing = block num
+#include <limits>
+
+#include "cost/bound.hpp"
 
-using PartitionVector =
-    std::unordered_map<DNN::Dimension, std::tuple<int, int, int>,
-                       DNN::DimensionHash>;
+// spatial * temporal * sharing = block num
 
 class PartitionAnalysis {
  public:
   PartitionAnalysis(const std::shared_ptr<DNN::OperatorGroup> _group,
                     const std::shared_ptr<Architecture::Mesh> _mesh)
-      : group(_group), mesh(_mesh) {
-    std::tie(operators, tensors, dimensions, internalTensors, externalTensors) =
-        group->getGroupInfo();
+      : mesh(_mesh), group(_group) {
+    // Compile the group once and pick the kernel of its dimension count
+    // and tensor rank
+    layout = std::make_shared<const Cost::Layout>(*group);
+    kernel = Cost::specialise(layout);
   }
 
+  // Every copy evaluates its own partition
+  PartitionAnalysis(const PartitionAnalysis& other)
+      : mesh(other.mesh),
+        doubleBuffering(other.doubleBuffering),
+        group(other.group),
+        layout(other.layout),
+        kernel(other.kernel->clone()) {}
+
+  PartitionAnalysis& operator=(const PartitionAnalysis& other) {
+    if (this == &other) return *this;
+    mesh = other.mesh;
+    doubleBuffering = other.doubleBuffering;
+    group = other.group;
+    layout = other.layout;
+    kernel = other.kernel->clone();
+    return *this;
+  }
+
+  PartitionAnalysis(PartitionAnalysis&&) = default;
+  PartitionAnalysis& operator=(PartitionAnalysis&&) = default;
+
   // Set the partition vector of each dimension
-  void setPartitionVector(const PartitionVector _p,
-                          const std::vector<DNN::Dimension> _o) noexcept {
-    partitionVector = _p;
-    orderedDimensions = _o;
+  void setPartitionVector(const PartitionVector& _p,
+                          const std::vector<DNN::Dimension>& _o) {
+    kernel->set(_p, _o);
+  }
+
+  // Overlap the next tile's transfer with the current tile's computation
+  void setDoubleBuffering(bool _doubleBuffering) noexcept {
+    doubleBuffering = _doubleBuffering;
   }
 
   int evaluate() const noexcept {
@@ -30,206 +56,122 @@ class PartitionAnalysis {
 
     int a = std::max(onchip_cost, offchip_cost);
     int b = std::min(onchip_cost, offchip_cost);
-    return a - b + c;
-  }
-
-  bool constraint() const noexcept {
-    int footprint = calculatePartitionFootprint();
-    return mesh->footprintPerCore > footprint;
+    int transfer = a - b + c;
+    int compute = calculatePartitionCompute();
+
+    // Per tile the latency is max(compute, transfer) when the two overlap;
+    // every tile step is identical, so this holds for the totals as well
+    long long latency = doubleBuffering ? std::max(compute, transfer)
+                                        : 1LL * compute + transfer;
+
+    // Spatial blocks beyond the core number run in sequential waves
+    latency *= getSpatialWaves();
+    return static_cast<int>(
+        std::min<long long>(latency, std::numeric_limits<int>::max()));
   }
 
-  // Get the tile size of each tensor
-  int getTileSize(const DNN::Tensor& tensor) const noexcept {
-    int tile_size = 1;
+  // Check if the footprint fits the buffer of a core
+  bool constraint() const noexcept { return getViolation() == 0.0; }
 
-    for (auto& dim : tensor.getDimensions()) {
-      auto [spatial, temporal, sharing] = partitionVector.at(dim);
-      int blockNum = spatial * temporal * sharing;
-
-      tile_size *= dim.getSize() / blockNum;
-    }
+  // Get the footprint in excess of a core's buffer relative to its size,
+  // 0 when it fits
+  double getViolation() const noexcept {
+    int footprint = calculatePartitionFootprint();
+    if (mesh->footprintPerCore > footprint) return 0.0;
 
-    return tile_size;
+    return (1.0 + footprint - mesh->footprintPerCore) /
+           std::max(1, mesh->footprintPerCore);
   }
 
-  // Calculate the reduction cost of each operator
-  int partitionReductionCost() const noexcept {
-    int cost = 0;
+  // Get a lower bound of evaluate() over the partitions the mapper draws
+  long long getCostBound() const { return Cost::getCostBound(*layout, *mesh); }
+
+  // Get the smallest footprint of a partition: every tile a single element,
+  // split spatially so no stored tensor holds more than one, and only the
+  // bytes live at once counted. Tiles emptied by more blocks than elements
+  // are degenerate and not considered
+  int getFootprintBound() const {
+    PartitionVector p;
+    for (size_t i = 0; i < layout->dims.size(); i++)
+      p[layout->dims[i]] = std::make_tuple(layout->sizes[i], 1, 1);
+
+    auto single = kernel->clone();
+    single->set(p, layout->dims);
+    return single->footprint(doubleBuffering, Cost::Allocation::Live);
+  }
 
-    for (const auto& op : operators) {
-      auto reduction_dims = op.getReductionDimensions();
+  // Get the largest footprint of a partition: every tile a whole dimension
+  // and every buffer live at once
+  int getFootprintCeiling() const {
+    PartitionVector p;
+    for (const auto& dim : layout->dims) p[dim] = std::make_tuple(1, 1, 1);
 
-      for (const auto& dim : reduction_dims) {
-        auto [spatial, temporal, sharing] = partitionVector.at(dim);
+    auto whole = kernel->clone();
+    whole->set(p, layout->dims);
+    return whole->footprint(doubleBuffering, Cost::Allocation::Total);
+  }
 
-        // only consider dimensions that are partitioned spatially
-        if (spatial == 1) continue;
+  // Check if any partition may fit the buffer of a core
+  bool isFeasible() const {
+    return mesh->footprintPerCore > getFootprintBound();
+  }
 
-        // find reduce tensor
-        for (const auto& tensor : op.getOutputs()) {
-          auto tensor_dims = tensor.getDimensions();
-          if (!std::count(tensor_dims.begin(), tensor_dims.end(), dim))
-            continue;
+  // Get the number of tile steps one core iterates through
+  long long getTileSteps() const noexcept { return kernel->getTileSteps(); }
 
-          // all-reduce cost
-          int coreGroupNum = mesh->coreNum / spatial;
-          int blockSize = getTileSize(tensor);
+  // Get the number of rounds the spatial blocks take on the cores
+  long long getSpatialWaves() const noexcept {
+    return kernel->getSpatialWaves(mesh->coreNum);
+  }
 
-          int traffic = blockSize * (coreGroupNum - 1);
+  // Calculate the compute latency of one core (roofline compute roof)
+  int calculatePartitionCompute() const noexcept {
+    return kernel->compute(*mesh);
+  }
 
-          // tensor reduce cost
-          cost += traffic / mesh->onchipBandwidth;
-        }
-      }
-    }
+  // Calculate the reduction cost of each operator
+  int partitionReductionCost() const noexcept {
+    return kernel->reduction(*mesh);
+  }
 
-    return cost;
+  // Get the algorithm picked for every reduction split across cores
+  std::vector<Cost::Collective> getCollectives() const {
+    std::vector<Cost::Collective> collectives;
+    kernel->reduction(*mesh, &collectives);
+    return collectives;
   }
 
   // Calculate the traffic of each tensor among opeartor group
   std::pair<int, int> calculatePartitionTraffic() const noexcept {
-    int onchip_cost = 0;
-    int offchip_cost = 0;
-
-    for (const auto& op : operators) {
-      // Calculate the traffic of each tensor
-      for (const auto& tensor : op.getTensors()) {
-        // Check if the tensor is fused, which means it is consumed by other in
-        // lcoal buffer
-        bool is_tensor_fused =
-            std::count(internalTensors.begin(), internalTensors.end(), tensor);
-
-        if (is_tensor_fused)
-          // Skip internal tensors
-          continue;
-
-        int tile_size = getTileSize(tensor);
-
-        int onchip_traffic = tile_size;
-        int offchip_traffic = tile_size;
-
-        bool access_tensor = false;
-        auto tensor_dims = tensor.getDimensions();
-
-        for (auto& dim : orderedDimensions) {
-          // From inner loop to outer loop
-
-          bool dim_in_tensor =
-              std::count(tensor_dims.begin(), tensor_dims.end(), dim);
-          // Now we only consider the outer loop
-          if (dim_in_tensor) access_tensor = true;
-
-          // Skip the inner loop
-          if (!access_tensor) continue;
-
-          auto [spatial, temporal, sharing] = partitionVector.at(dim);
-
-          // Calculate the traffic of sharing tensor (or sharing == 1)
-          onchip_traffic *= temporal * (sharing - 1);
-          offchip_traffic *= temporal;
-        }
-
-        // Calculate the traffic latency of spatial tensor
-        onchip_cost += onchip_traffic / mesh->onchipBandwidth;
-        offchip_cost += offchip_traffic / mesh->offchipBandwidth;
-      }
-    }
-
-    return {onchip_cost, offchip_cost};
+    return kernel->traffic(*mesh);
   }
 
-  // Calculate the footprint of each the opeartor group
+  // Calculate the footprint of the operator group: the peak of its tile
+  // buffers, placed so that buffers live at different operators share bytes
   int calculatePartitionFootprint() const noexcept {
-    int volume = 0;
-
-    for (const auto& op : operators) {
-      // Collect the dimensions of the operator
-      std::unordered_set<DNN::Dimension, DNN::DimensionHash> op_dims;
-
-      for (const auto& tensor : op.getTensors())
-        for (const auto& dim : tensor.getDimensions()) op_dims.insert(dim);
-
-      // Calculate the footprint of each tensor
-      for (const auto& tensor : op.getTensors()) {
-        int tile_size = getTileSize(tensor);
-
-        int footprint = tile_size;
-
-        // Check if the tensor is fused, which means it is consumed by other in
-        // lcoal buffer
-        bool is_tensor_fused =
-            std::count(internalTensors.begin(), internalTensors.end(), tensor);
-
-        if (!is_tensor_fused) {
-          // Do not require to stage the dimensions of other tensors
-          volume += footprint;
-          continue;
-        }
-
-        auto outputs = op.getOutputs();
-        // Calculate the footprint of each tensor if it is the output tensor
-        if (!std::count(outputs.begin(), outputs.end(), tensor)) continue;
-
-        auto tensor_dims = tensor.getDimensions();
-        bool expand = false;
-        for (auto it = orderedDimensions.rbegin();
-             it != orderedDimensions.rend(); it++) {
-          // From outer loop to inner loop
-          auto dim = *it;
-
-          // Get the partition info
-          auto [spatial, temporal, sharing] = partitionVector.at(dim);
-
-          if (!std::count(op_dims.begin(), op_dims.end(), dim))
-            // Skip the loop of other operators
-            continue;
-
-          if (!std::count(tensor_dims.begin(), tensor_dims.end(), dim))
-            // The loop dimensions of other tensors nested within it
-            expand = true;
-          continue;
-
-          if (expand)
-            // Extend the outer loops of the fused tensor
-            footprint *= temporal * sharing;
-
-          volume += footprint;
-        }
-      }
-    }
-
-    return volume;
+    return kernel->footprint(doubleBuffering);
   }
 
   auto getOperatorGroup() const noexcept { return group; }
 
+  // Get the index form of the group
+  auto getLayout() const noexcept { return layout; }
+
  private:
   // Mesh
   std::shared_ptr<Architecture::Mesh> mesh;
 
-  // Partition Vector
-  PartitionVector partitionVector;
-
-  // Ordered dimensions of tile loop
-  std::vector<DNN::Dimension> orderedDimensions;
+  // Double-buffered staging of transferred tiles
+  bool doubleBuffering = false;
 
   // Operator Group
   std::shared_ptr<DNN::OperatorGroup> group;
 
-  // Operators
-  std::vector<DNN::Operator> operators;
-
-  // Tensors
-  std::unordered_set<DNN::Tensor, DNN::TensorHash> tensors;
-
-  // Dimensions
-  std::unordered_set<DNN::Dimension, DNN::DimensionHash> dimensions;
-
-  // Internal tensors
-  std::unordered_set<DNN::Tensor, DNN::TensorHash> internalTensors;
+  // Index form of the group
+  std::shared_ptr<const Cost::Layout> layout;
 
-  // External tensors
-  std::unordered_set<DNN::Tensor, DNN::TensorHash> externalTensors;
+  // Cost kernel of the group, holding the current partition
+  std::unique_ptr<Cost::IKernel> kernel;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,164 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "mapper.hpp"
+#include "stages.hpp"
+
+// Schedule of the groups of one fusion candidate as a spatial pipeline
+struct PipelineReport {
+  // Cores of each stage
+  std::vector<int> cores;
+
+  // Cycles of each stage per micro-batch
+  std::vector<int> stageCycles;
+
+  // Cycles handing the outputs of each stage to later stages
+  std::vector<int> transferCycles;
+
+  // Cycles between two micro-batches in steady state
+  long long interval = std::numeric_limits<int>::max();
+
+  // Cycles of one micro-batch from the first stage to the last
+  long long latency = std::numeric_limits<int>::max();
+
+  // Cycles of all micro-batches, including pipeline fill and drain
+  long long makespan = std::numeric_limits<int>::max();
+
+  // Number of micro-batches
+  int microBatches = 1;
+
+  // Check if every stage got cores and a feasible mapping
+  bool isFeasible() const noexcept {
+    return interval < std::numeric_limits<int>::max();
+  }
+
+  // Steady-state micro-batches per cycle
+  double getThroughput() const noexcept {
+    return isFeasible() ? 1.0 / interval : 0.0;
+  }
+};
+
+// Places consecutive groups on disjoint core subsets and runs them as a
+// pipeline over micro-batches. Every group is mapped once per core count on
+// a mesh of that size, then a dynamic program over the stages picks the
+// allocation with the smallest interval, breaking ties by latency. Outputs
+// consumed by later stages move over the on-chip network; the transfer
+// overlaps the stages as its own pipeline step.
+class PipelinePlanner {
+ public:
+  PipelinePlanner(
+      const std::vector<std::shared_ptr<DNN::OperatorGroup>> _groups,
+      const std::shared_ptr<Architecture::Mesh> _mesh, uint64_t _seed = 0,
+      const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : groups(_groups), mesh(_mesh), seed(_seed), scheduler(_scheduler) {}
+
+  // Set the number of micro-batches streamed through the pipeline
+  void setMicroBatches(int _microBatches) noexcept {
+    microBatches = std::max(1, _microBatches);
+  }
+
+  PipelineReport plan() const {
+    PipelineReport report;
+    report.microBatches = microBatches;
+
+    int stages = groups.size();
+    int cores = mesh->coreNum;
+    if (stages == 0 || stages > cores) return report;
+
+    // Best cost of each stage on 1 to `cores` cores
+    std::vector<std::vector<int>> costs(stages, std::vector<int>(cores + 1));
+    Runtime::parallelFor(scheduler, stages * cores, [&](int i) {
+      int s = i / cores;
+      int c = i % cores + 1;
+      costs[s][c] = mapStage(s, c);
+    });
+
+    report.transferCycles = getTransferCycles();
+    long long transfer_interval = 0;
+    long long transfer_latency = 0;
+    for (auto cycles : report.transferCycles) {
+      transfer_interval = std::max<long long>(transfer_interval, cycles);
+      transfer_latency += cycles;
+    }
+
+    // One group per stage
+    auto plan = planStages(
+        stages, cores, 1,
+        [&](int s, int, int c) -> StageScore {
+          if (costs[s][c] == std::numeric_limits<int>::max()) return NO_STAGES;
+          return {costs[s][c], costs[s][c]};
+        },
+        std::less<StageScore>());
+    if (!plan.isFeasible()) return report;
+    auto [interval, latency] = plan.score;
+
+    report.cores = plan.units;
+    report.stageCycles.resize(stages);
+    for (int s = 0; s < stages; s++)
+      report.stageCycles[s] = costs[s][plan.units[s]];
+
+    report.interval = std::max(interval, transfer_interval);
+    report.latency = latency + transfer_latency;
+    report.makespan = report.latency + (microBatches - 1) * report.interval;
+    return report;
+  }
+
+ private:
+  // Map stage s on a mesh of c cores and return its best cost
+  int mapStage(int s, int c) const {
+    auto sub_mesh = std::make_shared<Architecture::Mesh>(*mesh);
+    sub_mesh->coreNum = c;
+
+    auto analysis = std::make_shared<PartitionAnalysis>(groups[s], sub_mesh);
+    auto stage_seed =
+        Algorithm::Random::derive(Algorithm::Random::derive(seed, s), c);
+    Mapper mapper(analysis, stage_seed, scheduler);
+
+    mapper.search();
+    return mapper.getBestCost();
+  }
+
+  // Cycles moving each stage's outputs to the stages consuming them
+  std::vector<int> getTransferCycles() const {
+    std::vector<int> cycles(groups.size(), 0);
+
+    for (size_t s = 0; s < groups.size(); s++) {
+      const auto& outputs = std::get<4>(groups[s]->getGroupInfo());
+      long long bytes = 0;
+
+      for (const auto& tensor : outputs)
+        if (isProducedBy(s, tensor) && isConsumedAfter(groups, s, tensor))
+          bytes += getTensorBytes(*groups[s], tensor);
+
+      cycles[s] = static_cast<int>(std::min<long long>(
+          bytes / mesh->onchipBandwidth, std::numeric_limits<int>::max()));
+    }
+
+    return cycles;
+  }
+
+  // Check if an operator of stage s produces the tensor
+  bool isProducedBy(size_t s, const DNN::Tensor& tensor) const {
+    for (const auto& op : std::get<0>(groups[s]->getGroupInfo())) {
+      const auto& outputs = op.getOutputs();
+      if (std::count(outputs.begin(), outputs.end(), tensor)) return true;
+    }
+    return false;
+  }
+
+  // Groups in execution order, one pipeline stage each
+  std::vector<std::shared_ptr<DNN::OperatorGroup>> groups;
+
+  std::shared_ptr<Architecture::Mesh> mesh;
+
+  // Seed of the stage mappings
+  uint64_t seed;
+
+  // Number of micro-batches
+  int microBatches = 1;
+
+  // Scheduler of the stage mappings, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Runtime {
+// Flag polled by long-running tasks to stop early
+class CancellationToken {
+ public:
+  void cancel() noexcept { cancelled.store(true, std::memory_order_relaxed); }
+
+  bool isCancelled() const noexcept {
+    return cancelled.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> cancelled{false};
+};
+
+// Work-stealing task scheduler. Each worker owns a deque: it pushes and pops
+// its own tasks at the back (depth first, cache warm) and idle workers steal
+// from the front of the others (breadth first, large tasks). Threads waiting
+// on a TaskGroup keep executing tasks, so nested fork/join never blocks a
+// worker and never oversubscribes the cores.
+class Scheduler {
+ public:
+  explicit Scheduler(int threads = std::thread::hardware_concurrency())
+      : queues(std::max(1, threads)) {
+    for (int i = 0; i < static_cast<int>(queues.size()); i++)
+      workers.emplace_back([this, i] { work(i); });
+  }
+
+  ~Scheduler() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &worker : workers) worker.join();
+  }
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // Get the number of worker threads
+  int getThreadNum() const noexcept { return static_cast<int>(queues.size()); }
+
+  // Get the index of the calling worker, -1 outside the pool
+  int getWorkerIndex() const noexcept {
+    return current == this ? currentIndex : -1;
+  }
+
+  // Submit a task; workers keep it local, other threads spread it round-robin
+  void submit(std::function<void()> task) {
+    int index = getWorkerIndex();
+    if (index < 0) index = next.fetch_add(1) % queues.size();
+
+    {
+      std::lock_guard<std::mutex> lock(queues[index].mutex);
+      queues[index].tasks.push_back(std::move(task));
+    }
+    pending.fetch_add(1);
+    wakeup.notify_one();
+  }
+
+  // Run one queued task if there is any
+  bool runOne() {
+    std::function<void()> task;
+    if (!take(task)) return false;
+
+    pending.fetch_sub(1);
+    task();
+    return true;
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  // Pop from the own deque, then steal from the others
+  bool take(std::function<void()> &task) {
+    int self = getWorkerIndex();
+    int num = static_cast<int>(queues.size());
+
+    if (self >= 0) {
+      std::lock_guard<std::mutex> lock(queues[self].mutex);
+      if (!queues[self].tasks.empty()) {
+        task = std::move(queues[self].tasks.back());
+        queues[self].tasks.pop_back();
+        return true;
+      }
+    }
+
+    int start = self >= 0 ? self + 1 : 0;
+    for (int k = 0; k < num; k++) {
+      auto &victim = queues[(start + k) % num];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (victim.tasks.empty()) continue;
+
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+
+    return false;
+  }
+
+  void work(int index) {
+    current = this;
+    currentIndex = index;
+
+    while (true) {
+      if (runOne()) continue;
+
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      if (stopping) return;
+      wakeup.wait_for(lock, std::chrono::milliseconds(1),
+                      [&] { return stopping || pending.load() > 0; });
+    }
+  }
+
+  // Scheduler and worker index of the calling thread
+  static inline thread_local const Scheduler *current = nullptr;
+  static inline thread_local int currentIndex = -1;
+
+  // Per-worker task deques
+  std::vector<Queue> queues;
+
+  // Worker threads
+  std::vector<std::thread> workers;
+
+  // Number of queued tasks
+  std::atomic<int> pending{0};
+
+  // Round-robin cursor for tasks submitted from outside the pool
+  std::atomic<unsigned> next{0};
+
+  // Sleeping of idle workers
+  std::mutex sleepMutex;
+  std::condition_variable wakeup;
+  bool stopping = false;
+};
+
+// Fork/join scope: tasks run through the scheduler and wait() returns once
+// all of them finished, executing queued tasks in the meantime. Tasks that
+// have not started when the group is cancelled are skipped.
+class TaskGroup {
+ public:
+  TaskGroup(const std::shared_ptr<Scheduler> _scheduler,
+            const std::shared_ptr<CancellationToken> _token = nullptr)
+      : scheduler(_scheduler),
+        token(_token ? _token : std::make_shared<CancellationToken>()) {}
+
+  ~TaskGroup() { wait(); }
+
+  // Fork a task, or run it inline without a scheduler
+  void run(std::function<void()> task) {
+    if (!scheduler) {
+      if (!token->isCancelled()) task();
+      return;
+    }
+
+    pending->fetch_add(1);
+    scheduler->submit([task = std::move(task), token = token,
+                       pending = pending] {
+      if (!token->isCancelled()) task();
+      pending->fetch_sub(1);
+    });
+  }
+
+  // Join all forked tasks
+  void wait() {
+    while (pending->load() > 0) {
+      if (!scheduler->runOne()) std::this_thread::yield();
+    }
+  }
+
+  // Skip the tasks that did not start yet and signal the running ones
+  void cancel() noexcept { token->cancel(); }
+
+  // Get the token polled by the tasks of the group
+  auto getToken() const noexcept { return token; }
+
+ private:
+  // Scheduler, or nullptr to run sequentially
+  std::shared_ptr<Scheduler> scheduler;
+
+  // Cancellation of the group
+  std::shared_ptr<CancellationToken> token;
+
+  // Number of unfinished tasks
+  std::shared_ptr<std::atomic<int>> pending =
+      std::make_shared<std::atomic<int>>(0);
+};
+
+// Run f(0), ..., f(n - 1) as tasks and join them
+template <typename Function>
+void parallelFor(const std::shared_ptr<Scheduler> scheduler, int n,
+                 Function &&f) {
+  TaskGroup group(scheduler);
+  for (int i = 0; i < n; i++) group.run([&f, i] { f(i); });
+  group.wait();
+}
+}  // namespace Runtime
+
+#endif
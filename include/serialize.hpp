@@ -0,0 +1,100 @@
+#ifndef SERIALIZE_HPP
+#define SERIALIZE_HPP
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Compact binary encoding of plain values, strings and vectors. Values are
+// stored in host byte order: the buffers are read back by the same binary.
+class BinaryWriter {
+ public:
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+  }
+
+  void writeString(const std::string& value) {
+    write<uint32_t>(value.size());
+    buffer.insert(buffer.end(), value.begin(), value.end());
+  }
+
+  template <typename T>
+  void writeVector(const std::vector<T>& values) {
+    write<uint32_t>(values.size());
+    for (const auto& value : values) write(value);
+  }
+
+  void writeBits(const std::vector<bool>& bits) {
+    write<uint32_t>(bits.size());
+    for (bool bit : bits) write<uint8_t>(bit);
+  }
+
+  const auto& getBuffer() const noexcept { return buffer; }
+
+ private:
+  std::vector<char> buffer;
+};
+
+class BinaryReader {
+ public:
+  BinaryReader(const std::vector<char>& _buffer) : buffer(_buffer) {}
+
+  template <typename T>
+  T read() noexcept {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value{};
+    if (!check(sizeof(T))) return value;
+
+    std::memcpy(&value, buffer.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+  }
+
+  std::string readString() {
+    auto size = read<uint32_t>();
+    if (!check(size)) return {};
+
+    std::string value(buffer.data() + offset, size);
+    offset += size;
+    return value;
+  }
+
+  template <typename T>
+  std::vector<T> readVector() {
+    auto size = read<uint32_t>();
+    std::vector<T> values;
+    for (uint32_t i = 0; i < size && good; i++) values.push_back(read<T>());
+    return values;
+  }
+
+  std::vector<bool> readBits() {
+    auto size = read<uint32_t>();
+    std::vector<bool> bits;
+    for (uint32_t i = 0; i < size && good; i++) bits.push_back(read<uint8_t>());
+    return bits;
+  }
+
+  // Check if every read so far was within the buffer
+  bool isGood() const noexcept { return good; }
+
+ private:
+  bool check(size_t size) noexcept {
+    if (offset + size > buffer.size()) good = false;
+    return good;
+  }
+
+  // Encoded bytes
+  const std::vector<char>& buffer;
+
+  // Read position
+  size_t offset = 0;
+
+  // Whether no read ran past the end
+  bool good = true;
+};
+
+#endif
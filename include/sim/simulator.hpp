@@ -0,0 +1,394 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <array>
+#include <climits>
+
+#include "partition.hpp"
+
+namespace Simulation {
+// Statistics of one simulated mapping
+struct Report {
+  // Cycles to play out the whole tile loop nest
+  long long cycles = 0;
+
+  // Cycles the core spends computing
+  long long computeCycles = 0;
+
+  // Cycles the DMA engine spends on off-chip transfers
+  long long dmaCycles = 0;
+
+  // Cycles the on-chip link spends on shared tiles and partial sums
+  long long linkCycles = 0;
+
+  // Peak number of bytes staged in the local buffer of one core
+  long long peakBufferOccupancy = 0;
+
+  // Number of simulated events (after batching)
+  long long events = 0;
+
+  double dmaUtilisation() const noexcept {
+    return cycles ? static_cast<double>(dmaCycles) / cycles : 0.0;
+  }
+
+  double linkUtilisation() const noexcept {
+    return cycles ? static_cast<double>(linkCycles) / cycles : 0.0;
+  }
+};
+
+// Knobs of the simulated mapping that the mesh description does not carry
+struct Config {
+  // Stage the next tile in a second buffer while the current one computes
+  bool doubleBuffering = false;
+};
+
+// Discrete-event simulator of one operator group on the mesh.
+//
+// Every core runs the same tile loop nest (SPMD), so one representative core
+// is simulated. The core, its DMA engine and its on-chip link are in-order
+// servers: each event (a tile transfer or a tile computation) is resolved
+// against the timeline of the resource it occupies. Repeated iterations of a
+// loop reach a periodic steady state, so after two periods the remaining ones
+// are fast-forwarded by the measured delta instead of being replayed.
+class MeshSimulator {
+ public:
+  MeshSimulator(const std::shared_ptr<DNN::OperatorGroup> _group,
+                const std::shared_ptr<Architecture::Mesh> _mesh,
+                const Config _config = Config())
+      : group(_group),
+        mesh(_mesh),
+        config(_config),
+        layout(std::make_shared<const Cost::Layout>(*group)) {}
+
+  Report run(const PartitionVector& partition,
+             const std::vector<DNN::Dimension>& o) noexcept {
+    // Fused normalizations keep their axis whole, as in the analytical model
+    auto p = partition;
+    for (const auto& dim : group->getResidentDimensions())
+      p[dim] = std::make_tuple(1, 1, 1);
+
+    compile(p, o);
+
+    State s{};
+    runNest(static_cast<int>(loops.size()) - 1, INT_MAX, false, s);
+
+    Report report;
+    report.cycles = s[COMPUTE_DONE] * waves;
+    report.computeCycles = s[COMPUTE_BUSY] * waves;
+    report.dmaCycles = s[DMA_BUSY] * waves;
+    report.linkCycles = s[LINK_BUSY] * waves;
+    report.events = s[EVENTS];
+    report.peakBufferOccupancy = bufferOccupancy(p);
+    return report;
+  }
+
+ private:
+  // Fields of the simulation state; all fields before EVENTS advance linearly
+  // in steady state, which is what makes fast-forwarding valid
+  enum Field {
+    COMPUTE_DONE,
+    PREV_COMPUTE_DONE,
+    DMA_FREE,
+    LINK_FREE,
+    COMPUTE_BUSY,
+    DMA_BUSY,
+    LINK_BUSY,
+    EVENTS,
+    FIELD_NUM
+  };
+
+  using State = std::array<long long, FIELD_NUM>;
+
+  // Operations of one run of an operator, run whenever a loop at or inside
+  // minLevel advances
+  struct Work {
+    int minLevel;
+    long long macs;
+  };
+
+  // A non-trivial loop of the tile loop nest
+  struct Loop {
+    DNN::Dimension dim;
+    int trip;
+    int sharing;
+  };
+
+  // A tensor transferred by the loop nest
+  struct Stream {
+    // Innermost loop level indexing the tensor
+    int minLevel;
+
+    // Loop levels indexing the tensor
+    std::vector<bool> levels;
+
+    // Bytes of one tile
+    long long tile;
+
+    // Link cycles of the partial-sum reduction on reload
+    long long reduce;
+  };
+
+  void compile(const PartitionVector& p,
+               const std::vector<DNN::Dimension>& o) noexcept {
+    auto [operators, tensors, dimensions, internalTensors, externalTensors] =
+        group->getGroupInfo();
+
+    // From inner loop to outer loop, dropping loops with a single iteration
+    loops.clear();
+    for (const auto& dim : o) {
+      auto [spatial, temporal, sharing] = p.at(dim);
+      if (temporal * sharing == 1) continue;
+      loops.push_back({dim, temporal * sharing, sharing});
+    }
+
+    // Spatial blocks beyond the core number run in sequential waves
+    long long blocks = 1;
+    for (const auto& dim : dimensions) blocks *= std::get<0>(p.at(dim));
+    waves = (blocks + mesh->coreNum - 1) / mesh->coreNum;
+
+    streams.clear();
+    works.clear();
+    std::unordered_set<DNN::Tensor, DNN::TensorHash> seen;
+
+    for (size_t o = 0; o < operators.size(); o++) {
+      const auto& op = operators[o];
+      std::unordered_set<DNN::Dimension, DNN::DimensionHash> op_dims;
+      for (const auto& tensor : op.getTensors())
+        for (const auto& dim : tensor.getDimensions()) op_dims.insert(dim);
+
+      // The operator runs again whenever one of its loops advances, which
+      // for recomputed producers includes the loops of their consumers
+      Work work{INT_MAX, op.getWorkPerPoint()};
+      for (const auto& dim : op_dims) work.macs *= extent(p, dim);
+      for (int l = 0; l < static_cast<int>(loops.size()); l++)
+        if (layout->operatorSteps[o] >> layout->getIndex(loops[l].dim) & 1)
+          work.minLevel = std::min(work.minLevel, l);
+      works.push_back(work);
+
+      // Inputs of a normalization are swept once per pass if its axis is
+      // split, unless it streams online
+      const auto& axis = op.getAxis();
+      int passes = axis && !group->isOnline(op) &&
+                           extent(p, *axis) < axis->getSize()
+                       ? op.getPasses()
+                       : 1;
+      int inputs = op.getInputs().size();
+
+      for (const auto& tensor : op.getTensors()) {
+        bool input = inputs-- > 0;
+        if (internalTensors.count(tensor) || !seen.insert(tensor).second)
+          continue;
+
+        Stream stream{INT_MAX, std::vector<bool>(loops.size(), false), 1, 0};
+        const auto& tensor_dims = tensor.getDimensions();
+
+        for (const auto& dim : tensor_dims) stream.tile *= extent(p, dim);
+        long long elements = stream.tile;
+        stream.tile *= DNN::getByteSize(group->getStorageType(tensor));
+        if (input) stream.tile *= passes;
+
+        for (int l = 0; l < static_cast<int>(loops.size()); l++) {
+          if (!std::count(tensor_dims.begin(), tensor_dims.end(),
+                          loops[l].dim))
+            continue;
+          stream.levels[l] = true;
+          stream.minLevel = std::min(stream.minLevel, l);
+        }
+
+        // Spatially split reductions combine partial sums of the output,
+        // which leaves the group and so may be written back in shards
+        const auto& outputs = op.getOutputs();
+        if (std::count(outputs.begin(), outputs.end(), tensor)) {
+          long long participants = 1;
+          for (const auto& dim : op.getReductionDimensions())
+            participants *= std::get<0>(p.at(dim));
+          participants = std::min<long long>(participants, mesh->coreNum);
+
+          // Partial sums travel in the accumulator type
+          int bytes =
+              DNN::getByteSize(DNN::getAccumulatorType(tensor.getType()));
+          stream.reduce = Cost::pickCollective(elements * bytes, participants,
+                                               false, *mesh)
+                              .second;
+        }
+
+        streams.push_back(stream);
+      }
+    }
+
+    // Outputs rescaled by an online softmax, whenever their operator runs
+    for (const auto& rescale : layout->rescales) {
+      Work work{works[rescale.op].minLevel, Cost::Layout::RESCALE_WORK};
+      for (int d : layout->accesses[rescale.access].dims)
+        work.macs *= extent(p, layout->dims[d]);
+      works.push_back(work);
+    }
+  }
+
+  // Tile extent of a dimension
+  static long long extent(const PartitionVector& p,
+                          const DNN::Dimension& dim) noexcept {
+    auto [spatial, temporal, sharing] = p.at(dim);
+    return std::max(1, dim.getSize() / (spatial * temporal * sharing));
+  }
+
+  static long long transferCycles(long long bytes, int bandwidth) noexcept {
+    return (bytes + bandwidth - 1) / bandwidth;
+  }
+
+  // Play out every iteration of the loops up to `level`. The first iteration
+  // is entered by advancing loop `enter`; `viaLink` tells whether that loop
+  // fetches its new tiles from a neighbouring core.
+  void runNest(int level, int enter, bool viaLink, State& s) const noexcept {
+    if (level < 0) {
+      step(enter, viaLink, s);
+      return;
+    }
+
+    const auto& loop = loops[level];
+    int periods = loop.trip / loop.sharing;
+
+    // Within a period the first tile comes from off-chip memory and the
+    // others are passed around the cores sharing it
+    auto runPeriod = [&](int period) {
+      for (int i = 0; i < loop.sharing; i++) {
+        if (period == 0 && i == 0)
+          runNest(level - 1, enter, viaLink, s);
+        else
+          runNest(level - 1, level, i != 0, s);
+      }
+    };
+
+    runPeriod(0);
+    if (periods == 1) return;
+
+    State before = s;
+    runPeriod(1);
+    if (periods == 2) return;
+
+    // Fast-forward the remaining periods; events count what was simulated
+    long long remaining = periods - 2;
+    for (int f = 0; f < EVENTS; f++) s[f] += (s[f] - before[f]) * remaining;
+  }
+
+  // One tile step: reload the tiles whose coordinates changed, then compute
+  void step(int enter, bool viaLink, State& s) const noexcept {
+    long long loads_done = s[COMPUTE_DONE];
+
+    // A tile can only be replaced once the computation reading the buffer
+    // finished: the previous one, or the one before when double buffering
+    long long buffer_free =
+        config.doubleBuffering ? s[PREV_COMPUTE_DONE] : s[COMPUTE_DONE];
+
+    for (const auto& stream : streams) {
+      // The tile changes if the advanced loop or a wrapped inner loop
+      // indexes the tensor; the very first step loads everything
+      bool reload = enter == INT_MAX || stream.minLevel <= enter;
+      if (!reload) continue;
+
+      bool link = viaLink && enter < static_cast<int>(loops.size()) &&
+                  stream.levels[enter];
+
+      long long link_bytes = 0;
+      long long dma_bytes = 0;
+      (link ? link_bytes : dma_bytes) += stream.tile;
+
+      if (dma_bytes) {
+        long long start = std::max(s[DMA_FREE], buffer_free);
+        long long cycles = transferCycles(dma_bytes, mesh->offchipBandwidth);
+        s[DMA_FREE] = start + cycles;
+        s[DMA_BUSY] += cycles;
+        loads_done = std::max(loads_done, s[DMA_FREE]);
+        s[EVENTS]++;
+      }
+
+      if (link_bytes || stream.reduce) {
+        long long start = std::max(s[LINK_FREE], buffer_free);
+        long long cycles = stream.reduce;
+        if (link_bytes)
+          cycles += transferCycles(link_bytes, mesh->onchipBandwidth);
+        s[LINK_FREE] = start + cycles;
+        s[LINK_BUSY] += cycles;
+        loads_done = std::max(loads_done, s[LINK_FREE]);
+        s[EVENTS]++;
+      }
+    }
+
+    long long macs = 0;
+    for (const auto& work : works)
+      if (enter == INT_MAX || work.minLevel <= enter) macs += work.macs;
+    long long compute =
+        (macs + mesh->computeThroughput - 1) / mesh->computeThroughput;
+    s[PREV_COMPUTE_DONE] = s[COMPUTE_DONE];
+    s[COMPUTE_DONE] = loads_done + compute;
+    s[COMPUTE_BUSY] += compute;
+    s[EVENTS]++;
+  }
+
+  // Bytes resident in the local buffer of one core
+  long long bufferOccupancy(const PartitionVector& p) const noexcept {
+    auto [operators, tensors, dimensions, internalTensors, externalTensors] =
+        group->getGroupInfo();
+
+    long long occupancy = 0;
+    for (const auto& stream : streams)
+      occupancy += config.doubleBuffering ? 2 * stream.tile : stream.tile;
+
+    // A stored fused tensor keeps every tile of its own loops that enclose a
+    // loop it does not depend on; a recomputed one keeps a single tile
+    bool recompute =
+        group->getFusedTensorMode() == DNN::FusedTensorMode::Recompute;
+    for (const auto& tensor : internalTensors) {
+      const auto& tensor_dims = tensor.getDimensions();
+      long long footprint = DNN::getByteSize(group->getStorageType(tensor));
+      for (const auto& dim : tensor_dims) footprint *= extent(p, dim);
+
+      bool nested = false;
+      for (const auto& loop : loops) {
+        if (recompute) break;
+        if (!std::count(tensor_dims.begin(), tensor_dims.end(), loop.dim))
+          nested = true;
+        else if (nested)
+          footprint *= loop.trip;
+      }
+      occupancy += footprint;
+    }
+
+    // Running maxima and sums of the online softmaxes
+    for (auto row : layout->states) {
+      long long state = Cost::Layout::STATE_BYTES;
+      for (size_t d = 0; d < layout->dims.size(); d++)
+        if (row >> d & 1) state *= extent(p, layout->dims[d]);
+      occupancy += state;
+    }
+
+    return occupancy;
+  }
+
+  // Operator group
+  std::shared_ptr<DNN::OperatorGroup> group;
+
+  // Mesh
+  std::shared_ptr<Architecture::Mesh> mesh;
+
+  // Simulator configuration
+  Config config;
+
+  // Index form of the group, for the loops re-running every operator
+  std::shared_ptr<const Cost::Layout> layout;
+
+  // Non-trivial loops from inner to outer
+  std::vector<Loop> loops;
+
+  // Transferred tensors
+  std::vector<Stream> streams;
+
+  // Operations of every operator and rescaling
+  std::vector<Work> works;
+
+  // Sequential waves of spatial blocks
+  long long waves = 1;
+};
+}  // namespace Simulation
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef STAGES_HPP
+#define STAGES_HPP
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "dnn/group.hpp"
+
+// Score of pipeline stages: cycles between two micro-batches in steady
+// state, then cycles of one micro-batch through every stage
+using StageScore = std::pair<long long, long long>;
+
+// Score of stages that cannot run
+inline constexpr StageScore NO_STAGES = {std::numeric_limits<long long>::max(),
+                                         0};
+
+// Consecutive items split into stages over processors, by first item and
+// processors of each stage
+struct StagePlan {
+  std::vector<int> firstItems;
+  std::vector<int> units;
+
+  StageScore score = NO_STAGES;
+
+  // Check if every stage got processors and can run
+  bool isFeasible() const noexcept { return score != NO_STAGES; }
+};
+
+// Split `items` consecutive items into stages over at most `units`
+// processors by a dynamic program over items and processors. `stage(first,
+// last, u)` scores items first..last-1 as one stage on u processors, or
+// returns NO_STAGES if they cannot run, and then neither can any longer
+// stage from the same item; a stage holds at most `length` items. Stages
+// add up their latencies and the slowest sets the interval; `better`
+// orders the scores.
+template <typename Stage, typename Better>
+StagePlan planStages(int items, int units, int length, Stage stage,
+                     Better better) {
+  StagePlan plan;
+  if (items == 0 || units < 1) return plan;
+
+  // best[i][u]: score of items 0..i-1 on u processors
+  std::vector<std::vector<StageScore>> best(
+      items + 1, std::vector<StageScore>(units + 1, NO_STAGES));
+  std::vector<std::vector<std::pair<int, int>>> choice(
+      items + 1, std::vector<std::pair<int, int>>(units + 1));
+  best[0][0] = {0, 0};
+
+  for (int first = 0; first < items; first++) {
+    for (int used = 0; used < units; used++) {
+      if (best[first][used] == NO_STAGES) continue;
+
+      for (int u = 1; used + u <= units; u++) {
+        for (int last = first + 1;
+             last <= std::min(items, first + length); last++) {
+          auto own = stage(first, last, u);
+          if (own == NO_STAGES) break;
+
+          StageScore score = {std::max(best[first][used].first, own.first),
+                              best[first][used].second + own.second};
+          if (!better(score, best[last][used + u])) continue;
+
+          best[last][used + u] = score;
+          choice[last][used + u] = {first, u};
+        }
+      }
+    }
+  }
+
+  // Idle processors are allowed, a stage may not gain from more of them
+  int used = 0;
+  for (int u = 1; u <= units; u++)
+    if (better(best[items][u], best[items][used])) used = u;
+  if (best[items][used] == NO_STAGES) return plan;
+  plan.score = best[items][used];
+
+  for (int last = items; last > 0;) {
+    auto [first, u] = choice[last][used];
+    plan.firstItems.insert(plan.firstItems.begin(), first);
+    plan.units.insert(plan.units.begin(), u);
+    last = first;
+    used -= u;
+  }
+  return plan;
+}
+
+// Check if an operator of a group after g consumes the tensor
+inline bool isConsumedAfter(
+    const std::vector<std::shared_ptr<DNN::OperatorGroup>>& groups, size_t g,
+    const DNN::Tensor& tensor) {
+  for (size_t t = g + 1; t < groups.size(); t++) {
+    for (const auto& op : std::get<0>(groups[t]->getGroupInfo())) {
+      const auto& inputs = op.getInputs();
+      if (std::count(inputs.begin(), inputs.end(), tensor)) return true;
+    }
+  }
+  return false;
+}
+
+// Bytes of a whole tensor as a group stores it
+inline long long getTensorBytes(const DNN::OperatorGroup& group,
+                                const DNN::Tensor& tensor) {
+  long long bytes = DNN::getByteSize(group.getStorageType(tensor));
+  for (const auto& dim : tensor.getDimensions()) bytes *= dim.getSize();
+  return bytes;
+}
+
+#endif
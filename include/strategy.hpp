@@ -0,0 +1,728 @@
+#ifndef STRATEGY_HPP
+#define STRATEGY_HPP
+
+#include <map>
+
+#include "algo/annealing.hpp"
+#include "joint.hpp"
+#include "local.hpp"
+
+// Everything a strategy needs to search the mappings of one group
+struct StrategyContext {
+  std::vector<DNN::Dimension> dims;
+
+  // Evaluation of the cost model, safe to call from any worker
+  MappingCost eval;
+  MappingViolation cons;
+
+  uint64_t seed = 0;
+
+  // Scheduler of the evaluations, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Cancellation of the search
+  std::shared_ptr<Runtime::CancellationToken> token;
+
+  // Treatment of mappings that overflow a core's buffer
+  Algorithm::ConstraintHandling handling =
+      Algorithm::ConstraintHandling::Repair;
+  double penalty = 1.0;
+
+  // Fraction of candidates evaluated exactly (0 disables the surrogate)
+  double surrogateFraction = 0.0;
+
+  // Mappings seeding the search
+  std::vector<Mapping> warmStart;
+
+  // Local search refining the best individuals of every generation, and
+  // their number
+  std::shared_ptr<LocalSearch> localSearch;
+  int elites = 0;
+
+  // Classes of loop orders the mappings keep canonical, or nullptr
+  std::shared_ptr<const OrderSpace> orders;
+
+  // Size of the population and number of generations of the genetic
+  // algorithm, which also size the budget of the other strategies
+  int population = 30;
+  int generations = 50;
+
+  // Prefix of the files every strategy snapshots its search to and resumes
+  // from, none if empty
+  std::string checkpointPath;
+
+  // Exact evaluations the genetic algorithm spends
+  long long getBudget() const noexcept {
+    return 1LL * population * (generations + 1);
+  }
+
+  // Build an individual holding a mapping
+  std::shared_ptr<PartitionIndividual> makeIndividual(
+      const Mapping& mapping) const {
+    Algorithm::Random scratch;
+    auto individual = std::make_shared<PartitionIndividual>(scratch, dims, eval,
+                                                            cons, orders);
+    individual->setMapping(mapping);
+    return individual;
+  }
+
+  // Get the snapshot a strategy left, if any
+  std::optional<std::vector<char>> loadCheckpoint(
+      const std::string& name) const {
+    if (checkpointPath.empty()) return std::nullopt;
+    return Checkpointer::load(checkpointPath + "." + name);
+  }
+
+  // Get the writer of a strategy's snapshots, or nullptr if none are taken
+  std::shared_ptr<Checkpointer> makeCheckpointer(
+      const std::string& name) const {
+    if (checkpointPath.empty()) return nullptr;
+    return std::make_shared<Checkpointer>(checkpointPath + "." + name);
+  }
+};
+
+// A search over the mappings of one group that runs in slices, so that
+// several can share a budget
+class SearchStrategy {
+ public:
+  virtual ~SearchStrategy() = default;
+
+  // Run until about `evaluations` more exact evaluations are spent or the
+  // search ends
+  virtual void advance(long long evaluations) = 0;
+
+  // Check if the search has ended
+  virtual bool isFinished() const = 0;
+
+  // Take a feasible mapping another strategy found, with its cost
+  virtual void adopt(const Mapping&, int) {}
+
+  // Get the best cost and mapping found so far
+  virtual int getBestCost() const = 0;
+  virtual Mapping getBestMapping() const = 0;
+
+  // Get the statistics of the search so far
+  virtual Algorithm::SearchStatistics getStatistics() const = 0;
+
+  // Get the feasible fraction of every generation, if the search has any
+  virtual std::vector<double> getFeasibilityRatios() const { return {}; }
+
+  // Follow the fraction of a shared budget spent so far, for strategies
+  // that schedule by their budget
+  virtual void setProgress(double) {}
+};
+
+// The genetic algorithm over PartitionIndividuals
+class GeneticStrategy : public SearchStrategy {
+ public:
+  GeneticStrategy(const StrategyContext& _context) : context(_context) {
+    reset();
+
+    // Continue from the last generation a previous run saved
+    if (auto snapshot = context.loadCheckpoint("genetic")) {
+      BinaryReader reader(*snapshot);
+      if (!ga->restore<PartitionIndividual>(reader, context.dims, context.eval,
+                                            context.cons, context.orders))
+        reset();
+    }
+    ga->setCheckpointer(context.makeCheckpointer("genetic"));
+  }
+
+  void advance(long long evaluations) override {
+    long long start = ga->getStatistics().evaluations;
+    while (!finished && ga->getStatistics().evaluations - start < evaluations)
+      finished = !ga->step();
+  }
+
+  bool isFinished() const override { return finished; }
+
+  void adopt(const Mapping& mapping, int cost) override {
+    ga->adopt(context.makeIndividual(mapping), cost);
+  }
+
+  int getBestCost() const override { return ga->getBestScore(); }
+
+  Mapping getBestMapping() const override {
+    auto best = std::dynamic_pointer_cast<PartitionIndividual>(
+        ga->getBestIndividual());
+    return best ? best->getMapping() : Mapping{};
+  }
+
+  Algorithm::SearchStatistics getStatistics() const override {
+    return ga->getStatistics();
+  }
+
+  std::vector<double> getFeasibilityRatios() const override {
+    return ga->getFeasibilityRatios();
+  }
+
+ private:
+  // Build the genetic algorithm and its initial population
+  void reset() {
+    ga = std::make_shared<Algorithm::GeneticAlgorithm>(
+        context.population, context.generations, 0.3f, 0.7f, context.seed);
+
+    ga->enableSurrogate(context.surrogateFraction);
+    ga->setScheduler(context.scheduler);
+    ga->setCancellationToken(context.token);
+    ga->setConstraintHandling(context.handling, context.penalty);
+
+    ga->initialize<PartitionIndividual>(context.dims, context.eval,
+                                        context.cons, context.orders);
+
+    std::vector<std::shared_ptr<Algorithm::IIndividual>> seeds;
+    for (const auto& mapping : context.warmStart)
+      seeds.push_back(context.makeIndividual(mapping));
+    ga->inject(seeds);
+
+    if (context.localSearch && context.elites > 0) {
+      auto localSearch = context.localSearch;
+      ga->setLocalSearch(
+          [localSearch](Algorithm::IIndividual& individual, int cost) {
+            auto& partition = static_cast<PartitionIndividual&>(individual);
+            auto mapping = partition.getMapping();
+            int refined = localSearch->refine(mapping, cost);
+            if (refined < cost) partition.setMapping(mapping);
+            return refined;
+          },
+          context.elites);
+    }
+  }
+
+  StrategyContext context;
+
+  std::shared_ptr<Algorithm::GeneticAlgorithm> ga;
+
+  // Whether the last generation ran
+  bool finished = false;
+};
+
+// Scores mappings for the strategies walking one mapping at a time: the
+// cost of feasible mappings, the worst cost otherwise
+class MappingScore {
+ public:
+  MappingScore(const StrategyContext& context)
+      : eval(context.eval), cons(context.cons) {}
+
+  int operator()(const Mapping& mapping) {
+    const auto& [p, o] = mapping;
+    statistics.evaluations++;
+    if (cons(p, o) > 0) return std::numeric_limits<int>::max();
+
+    statistics.feasibleEvaluations++;
+    return eval(p, o);
+  }
+
+  auto getStatistics() const noexcept { return statistics; }
+
+ private:
+  MappingCost eval;
+  MappingViolation cons;
+
+  Algorithm::SearchStatistics statistics;
+};
+
+// A mapping as an annealing state: neighbours mutate one dimension's
+// factors and reorder the loops, then shrink tiles until they fit
+class PartitionState : public Algorithm::IAnnealingState {
+ public:
+  PartitionState(const std::shared_ptr<PartitionIndividual> _individual,
+                 const std::shared_ptr<MappingScore> _score)
+      : individual(_individual), score(_score) {}
+
+  int evaluate() const override {
+    if (energy == UNSCORED) energy = (*score)(individual->getMapping());
+    return energy;
+  }
+
+  std::shared_ptr<IAnnealingState> getNeighbor(
+      Algorithm::Random& rng) const override {
+    auto neighbor = std::static_pointer_cast<PartitionIndividual>(
+        individual->clone());
+    neighbor->mutate(rng);
+    neighbor->repair();
+    return std::make_shared<PartitionState>(neighbor, score);
+  }
+
+  void print() const override { individual->print(); }
+
+  void save(BinaryWriter& writer) const override { individual->save(writer); }
+
+  Mapping getMapping() const { return individual->getMapping(); }
+
+ private:
+  static constexpr int UNSCORED = -1;
+
+  std::shared_ptr<PartitionIndividual> individual;
+
+  std::shared_ptr<MappingScore> score;
+
+  // Energy, scored on first use
+  mutable int energy = UNSCORED;
+};
+
+// Simulated annealing over PartitionStates. The temperature starts at a
+// fraction of the first state's cost and cools geometrically over the
+// budget of the genetic algorithm.
+class AnnealingStrategy : public SearchStrategy {
+ public:
+  // Initial temperature relative to the first cost, and final temperature
+  // relative to the initial one
+  static constexpr double INITIAL_TEMPERATURE = 0.1;
+  static constexpr double FINAL_TEMPERATURE = 1e-3;
+
+  AnnealingStrategy(const StrategyContext& _context)
+      : context(_context),
+        score(std::make_shared<MappingScore>(_context)) {
+    reset();
+
+    // Continue from the last step a previous run saved
+    if (auto snapshot = context.loadCheckpoint("annealing")) {
+      BinaryReader reader(*snapshot);
+      if (!sa->restore(reader, [&](BinaryReader& r) { return load(r); }))
+        reset();
+    }
+    sa->setCheckpointer(context.makeCheckpointer("annealing"),
+                        context.population);
+  }
+
+  void advance(long long evaluations) override {
+    long long start = score->getStatistics().evaluations;
+    while (!finished &&
+           score->getStatistics().evaluations - start < evaluations) {
+      if (context.token && context.token->isCancelled()) break;
+      finished = !sa->step();
+    }
+  }
+
+  bool isFinished() const override { return finished; }
+
+  void adopt(const Mapping& mapping, int cost) override {
+    auto individual = context.makeIndividual(mapping);
+    sa->adopt(std::make_shared<PartitionState>(individual, score), cost);
+  }
+
+  void setProgress(double progress) override {
+    sa->setTemperature(start * std::pow(FINAL_TEMPERATURE, progress));
+  }
+
+  int getBestCost() const override { return sa->getBestEnergy(); }
+
+  Mapping getBestMapping() const override {
+    auto best = std::static_pointer_cast<PartitionState>(sa->getBestState());
+    return best ? best->getMapping() : Mapping{};
+  }
+
+  Algorithm::SearchStatistics getStatistics() const override {
+    return score->getStatistics();
+  }
+
+ private:
+  // Build the annealing from the first state
+  void reset() {
+    Algorithm::Random rng(context.seed);
+    auto individual = std::make_shared<PartitionIndividual>(
+        rng, context.dims, context.eval, context.cons, context.orders);
+    if (!context.warmStart.empty())
+      individual->setMapping(context.warmStart.front());
+    individual->repair();
+
+    auto initial = std::make_shared<PartitionState>(individual, score);
+    start = std::max(
+        1.0, INITIAL_TEMPERATURE * std::min(initial->evaluate(), 1 << 30));
+    double cooling = std::pow(FINAL_TEMPERATURE,
+                              1.0 / std::max(1LL, context.getBudget()));
+
+    sa = std::make_shared<Algorithm::SimulatedAnnealing>(
+        initial, start, start * FINAL_TEMPERATURE, cooling,
+        Algorithm::Random::derive(context.seed, 1));
+    sa->setVerbose(false);
+  }
+
+  // Decode a state saved by PartitionState::save
+  std::shared_ptr<Algorithm::IAnnealingState> load(BinaryReader& reader) {
+    Algorithm::Random scratch;
+    auto individual = std::make_shared<PartitionIndividual>(
+        scratch, context.dims, context.eval, context.cons, context.orders);
+    individual->load(reader);
+    return std::make_shared<PartitionState>(individual, score);
+  }
+
+  StrategyContext context;
+
+  std::shared_ptr<MappingScore> score;
+
+  std::shared_ptr<Algorithm::SimulatedAnnealing> sa;
+
+  // Initial temperature
+  double start;
+
+  // Whether the temperature has fallen below the minimum
+  bool finished = false;
+};
+
+// A mapping built one decision at a time, as the mapping phase of
+// JointState: the factors of every dimension, then the loop order
+class MappingState : public Algorithm::IState {
+ public:
+  MappingState(const std::shared_ptr<const std::vector<DNN::Dimension>> _dims,
+               const std::shared_ptr<MappingScore> _score)
+      : dims(_dims), score(_score) {}
+
+  int getActionNum() const override {
+    int num = dims->size();
+    int offset = choices.size();
+    if (offset < 3 * num) return Cost::MAX_FACTOR;
+    return 4 * num - offset;
+  }
+
+  std::shared_ptr<IState> takeAction(int action) const override {
+    auto next = std::make_shared<MappingState>(*this);
+    next->choices.push_back(action);
+    return next;
+  }
+
+  bool isTerminated() const override {
+    return choices.size() == 4 * dims->size();
+  }
+
+  int evaluate() const override { return (*score)(getMapping()); }
+
+  uint64_t hash() const override {
+    uint64_t h = dims->size();
+    for (auto choice : choices) h = Algorithm::Random::derive(h, choice);
+    return h;
+  }
+
+  void print() const override {
+    std::cout << "Cost: " << evaluate() << "\n";
+  }
+
+  void save(BinaryWriter& writer) const override {
+    writer.writeVector(choices);
+  }
+
+  // Decode a state saved by save()
+  static std::shared_ptr<MappingState> load(
+      BinaryReader& reader,
+      const std::shared_ptr<const std::vector<DNN::Dimension>> dims,
+      const std::shared_ptr<MappingScore> score) {
+    auto state = std::make_shared<MappingState>(dims, score);
+    state->choices = reader.readVector<int>();
+    if (state->choices.size() > 4 * dims->size()) return nullptr;
+    return state;
+  }
+
+  // Get the mapping of a terminated state
+  Mapping getMapping() const {
+    auto choice = choices.cbegin();
+    return JointState::decode(*dims, choice);
+  }
+
+ private:
+  std::shared_ptr<const std::vector<DNN::Dimension>> dims;
+
+  std::shared_ptr<MappingScore> score;
+
+  // Decisions taken so far
+  std::vector<int> choices;
+};
+
+// UCT search over MappingStates, one rollout per evaluation. Mappings of
+// other strategies cannot enter the tree, so it only publishes its own.
+class TreeStrategy : public SearchStrategy {
+ public:
+  TreeStrategy(const StrategyContext& _context)
+      : context(_context),
+        score(std::make_shared<MappingScore>(_context)) {
+    auto dims =
+        std::make_shared<const std::vector<DNN::Dimension>>(context.dims);
+    mcts = std::make_shared<Algorithm::MonteCarloTreeSearch>(
+        0, std::make_shared<MappingState>(dims, score),
+        Algorithm::Random::derive(context.seed, 2));
+
+    // Continue from the last iteration a previous run saved
+    if (auto snapshot = context.loadCheckpoint("mcts")) {
+      BinaryReader reader(*snapshot);
+      mcts->restore(reader, [&](BinaryReader& r) {
+        return MappingState::load(r, dims, score);
+      });
+    }
+    mcts->setCheckpointer(context.makeCheckpointer("mcts"),
+                          context.population);
+  }
+
+  void advance(long long evaluations) override {
+    if (context.token && context.token->isCancelled()) return;
+
+    int iteration = mcts->getIteration();
+    mcts->setBudget(iteration + static_cast<int>(std::min<long long>(
+                                    evaluations,
+                                    std::numeric_limits<int>::max() -
+                                        iteration)));
+    mcts->search();
+  }
+
+  bool isFinished() const override { return false; }
+
+  int getBestCost() const override { return mcts->getBestCost(); }
+
+  Mapping getBestMapping() const override {
+    auto best = std::static_pointer_cast<MappingState>(mcts->getBestState());
+    return best ? best->getMapping() : Mapping{};
+  }
+
+  Algorithm::SearchStatistics getStatistics() const override {
+    return score->getStatistics();
+  }
+
+ private:
+  StrategyContext context;
+
+  std::shared_ptr<MappingScore> score;
+
+  std::shared_ptr<Algorithm::MonteCarloTreeSearch> mcts;
+};
+
+// Strategies by name. The built-in ones are "genetic", "annealing" and
+// "mcts"; others may be added before any search starts.
+class StrategyRegistry {
+ public:
+  using Factory =
+      std::function<std::unique_ptr<SearchStrategy>(const StrategyContext&)>;
+
+  static StrategyRegistry& getInstance() {
+    static StrategyRegistry registry;
+    return registry;
+  }
+
+  // Add or replace a strategy
+  void add(const std::string& name, const Factory& factory) {
+    factories[name] = factory;
+  }
+
+  // Create a strategy, or nullptr if there is none of that name
+  std::unique_ptr<SearchStrategy> create(
+      const std::string& name, const StrategyContext& context) const {
+    auto it = factories.find(name);
+    if (it == factories.end()) return nullptr;
+    return it->second(context);
+  }
+
+  // Get the names of every strategy
+  std::vector<std::string> getNames() const {
+    std::vector<std::string> names;
+    for (const auto& [name, factory] : factories) names.push_back(name);
+    return names;
+  }
+
+ private:
+  StrategyRegistry() {
+    add("genetic", [](const StrategyContext& context) {
+      return std::make_unique<GeneticStrategy>(context);
+    });
+    add("annealing", [](const StrategyContext& context) {
+      return std::make_unique<AnnealingStrategy>(context);
+    });
+    add("mcts", [](const StrategyContext& context) {
+      return std::make_unique<TreeStrategy>(context);
+    });
+  }
+
+  std::map<std::string, Factory> factories;
+};
+
+// Outcome of one strategy of a portfolio
+struct StrategyResult {
+  std::string name;
+
+  // Best cost the strategy found itself
+  int cost = std::numeric_limits<int>::max();
+
+  // Exact evaluations it spent, and its share of the last round
+  long long evaluations = 0;
+  double share = 0.0;
+};
+
+// Races several strategies on one group under a shared evaluation budget.
+// The budget is spent in rounds; within a round the strategies run
+// concurrently through the scheduler, each for its share of the round.
+// Between rounds the best mapping becomes the shared incumbent, offered to
+// every strategy, and the shares move towards the strategies that improved
+// on the incumbent the most per evaluation. A strategy keeps a minimum
+// share so that a late starter can still prove itself.
+class Portfolio {
+ public:
+  // Rounds the budget is spent in, and the smallest share of a round
+  static constexpr int ROUNDS = 10;
+  static constexpr double MIN_WEIGHT = 0.1;
+
+  Portfolio(const std::vector<std::string>& names,
+            const StrategyContext& context)
+      : budget(context.getBudget()), scheduler(context.scheduler) {
+    auto& registry = StrategyRegistry::getInstance();
+    for (size_t i = 0; i < names.size(); i++) {
+      // Every strategy draws from its own stream
+      auto own = context;
+      own.seed = Algorithm::Random::derive(context.seed, i);
+
+      auto strategy = registry.create(names[i], own);
+      if (!strategy) continue;
+      strategies.push_back(std::move(strategy));
+      results.push_back({names[i]});
+      weights.push_back(1.0);
+    }
+
+    // Continue from the last round a previous run started; the strategies
+    // resume from their own snapshots
+    if (auto snapshot = context.loadCheckpoint("portfolio")) {
+      BinaryReader reader(*snapshot);
+      int saved_round = reader.read<int>();
+      long long saved_spent = reader.read<long long>();
+      auto saved_weights = reader.readVector<double>();
+      if (reader.isGood() && saved_weights.size() == weights.size()) {
+        round = saved_round;
+        spent = saved_spent;
+        weights = saved_weights;
+        for (size_t i = 0; i < strategies.size(); i++) collect(i);
+      }
+    }
+    checkpointer = context.makeCheckpointer("portfolio");
+  }
+
+  void run() {
+    for (; round < ROUNDS && spent < budget; round++) {
+      if (checkpointer) {
+        BinaryWriter writer;
+        writer.write(round);
+        writer.write(spent);
+        writer.writeVector(weights);
+        checkpointer->submit(writer.getBuffer());
+      }
+
+      long long slice = (budget - spent) / (ROUNDS - round);
+
+      double total = 0.0;
+      for (size_t i = 0; i < strategies.size(); i++)
+        if (!strategies[i]->isFinished()) total += weights[i];
+      if (total <= 0) break;
+
+      // Run every strategy for its share of the round
+      std::vector<long long> before(strategies.size());
+      std::vector<long long> slices(strategies.size(), 0);
+      Runtime::TaskGroup group(scheduler);
+      for (size_t i = 0; i < strategies.size(); i++) {
+        before[i] = strategies[i]->getStatistics().evaluations;
+        results[i].share = 0.0;
+        if (strategies[i]->isFinished()) continue;
+
+        results[i].share = weights[i] / total;
+        strategies[i]->setProgress(1.0 * spent / budget);
+        slices[i] = std::max(1LL, static_cast<long long>(
+                                      slice * results[i].share));
+        group.run([&, i] { strategies[i]->advance(slices[i]); });
+      }
+      group.wait();
+
+      // Gains on the incumbent per evaluation
+      std::vector<double> rates(strategies.size(), 0.0);
+      int reference = bestCost;
+      for (size_t i = 0; i < strategies.size(); i++) {
+        const auto& result = collect(i);
+        spent += result.evaluations - before[i];
+
+        if (result.cost < reference) {
+          double gain = reference == std::numeric_limits<int>::max()
+                            ? 1.0
+                            : 1.0 * (reference - result.cost) / reference;
+          rates[i] = gain / std::max(1LL, result.evaluations - before[i]);
+        }
+      }
+
+      // Share the incumbent
+      if (bestCost == std::numeric_limits<int>::max()) continue;
+      for (size_t i = 0; i < strategies.size(); i++)
+        if (results[i].cost > bestCost)
+          strategies[i]->adopt(bestMapping, bestCost);
+
+      double fastest = *std::max_element(rates.begin(), rates.end());
+      if (fastest <= 0) continue;
+      for (size_t i = 0; i < strategies.size(); i++)
+        weights[i] = MIN_WEIGHT + rates[i] / fastest;
+    }
+  }
+
+  // Get the best cost and mapping over every strategy
+  auto getBestCost() const noexcept { return bestCost; }
+  const auto& getBestMapping() const noexcept { return bestMapping; }
+
+  // Get the name of the strategy that found the best mapping, empty if
+  // none found a feasible one
+  const auto& getWinner() const noexcept { return winner; }
+
+  // Get the outcome of every strategy
+  const auto& getResults() const noexcept { return results; }
+
+  // Get the statistics summed over the strategies
+  Algorithm::SearchStatistics getStatistics() const {
+    Algorithm::SearchStatistics sum;
+    for (const auto& strategy : strategies) {
+      auto statistics = strategy->getStatistics();
+      sum.evaluations += statistics.evaluations;
+      sum.feasibleEvaluations += statistics.feasibleEvaluations;
+      sum.surrogateSkipped += statistics.surrogateSkipped;
+      sum.surrogateErrorSum += statistics.surrogateErrorSum;
+      sum.surrogateErrorSamples += statistics.surrogateErrorSamples;
+    }
+    return sum;
+  }
+
+  // Get the feasible fractions of the first strategy that records them
+  std::vector<double> getFeasibilityRatios() const {
+    for (const auto& strategy : strategies) {
+      auto ratios = strategy->getFeasibilityRatios();
+      if (!ratios.empty()) return ratios;
+    }
+    return {};
+  }
+
+ private:
+  // Record the outcome of a strategy and take its best mapping if it beats
+  // the incumbent
+  const StrategyResult& collect(size_t i) {
+    auto& result = results[i];
+    result.evaluations = strategies[i]->getStatistics().evaluations;
+    result.cost = strategies[i]->getBestCost();
+    if (result.cost < bestCost) {
+      bestCost = result.cost;
+      bestMapping = strategies[i]->getBestMapping();
+      winner = result.name;
+    }
+    return result;
+  }
+
+  // Exact evaluations shared by the strategies
+  long long budget;
+
+  // Next round and the evaluations spent before it
+  int round = 0;
+  long long spent = 0;
+
+  // Writer of a snapshot at the start of every round, or nullptr
+  std::shared_ptr<Checkpointer> checkpointer;
+
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  std::vector<std::unique_ptr<SearchStrategy>> strategies;
+
+  // Outcome and weight of every strategy
+  std::vector<StrategyResult> results;
+  std::vector<double> weights;
+
+  // Shared incumbent and the strategy that found it
+  int bestCost = std::numeric_limits<int>::max();
+  Mapping bestMapping;
+  std::string winner;
+};
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <cmath>
+
+#include "fusion.hpp"
+
+// Result of one shape of a sweep
+struct SweepPoint {
+  // Dimension sizes given for the point
+  DNN::Shape shape;
+
+  // Best fusion candidate and its cost
+  std::vector<bool> fusion;
+  int cost = std::numeric_limits<int>::max();
+
+  // Best mapping of each group of the candidate
+  std::vector<Mapping> mappings;
+
+  // Exact evaluations spent on the point
+  long long evaluations = 0;
+};
+
+// Maps one model at many shapes in a single process, with the settings of
+// a fusion space. The first shape is searched cold over every fusion
+// candidate; later shapes keep its graph structure and groups, re-map the
+// best candidates of the last shapes and seed every group's search with the
+// best mappings of the nearest solved shapes, scaled to the new sizes. A
+// candidate left out whose lower bound beats the warm result is mapped too.
+class ShapeSweep {
+ public:
+  ShapeSweep(const std::shared_ptr<const FusionSpace> _space,
+             const std::shared_ptr<Architecture::Mesh> _mesh,
+             const std::shared_ptr<Runtime::Scheduler> _scheduler = nullptr)
+      : space(_space),
+        operatorGraph(_space->getOperatorGraph()),
+        mesh(_mesh),
+        scheduler(_scheduler) {}
+
+  // Set the number of top fusion candidates re-mapped at every later shape
+  void setCandidates(int _candidates) noexcept {
+    candidates = std::max(1, _candidates);
+  }
+
+  // Set the number of neighbouring shapes seeding a warm search
+  void setNeighbours(int _neighbours) noexcept {
+    neighbours = std::max(1, _neighbours);
+  }
+
+  // Set the population and generations of the warm-started searches
+  void setWarmBudget(int _population, int _generations) noexcept {
+    population = std::max(2, _population);
+    generations = std::max(1, _generations);
+  }
+
+  std::vector<SweepPoint> run(const std::vector<DNN::Shape> &partial) {
+    std::vector<SweepPoint> points;
+    if (partial.empty()) return points;
+
+    // Dimensions a shape leaves out keep the size of the graph
+    std::vector<DNN::Shape> shapes;
+    for (const auto &shape : partial) shapes.push_back(complete(shape));
+
+    int tensor_num = operatorGraph->getNumPotentialFusionTensors();
+    int combinations = 1 << tensor_num;
+
+    // Groups of every candidate, compiled once and resized to every shape
+    std::vector<std::vector<bool>> bits(combinations);
+    std::vector<std::vector<std::shared_ptr<DNN::OperatorGroup>>> groups(
+        combinations);
+    for (int i = 0; i < combinations; i++) {
+      bits[i].resize(tensor_num);
+      for (int j = 0; j < tensor_num; j++) bits[i][j] = (i >> j) & 1;
+      groups[i] = space->generateCandidateGroups(bits[i]);
+    }
+
+    auto resize = [&](int c, const std::shared_ptr<const DNN::DAG> resized,
+                      const DNN::Shape &shape) {
+      std::vector<std::shared_ptr<DNN::OperatorGroup>> resized_groups;
+      for (const auto &group : groups[c])
+        resized_groups.push_back(group->resize(resized, shape));
+      return resized_groups;
+    };
+
+    // Cold search of every candidate at the first shape
+    auto anchor = operatorGraph->resize(shapes.front());
+    std::vector<std::vector<Solution>> solved(
+        1, std::vector<Solution>(combinations));
+    Runtime::parallelFor(scheduler, combinations, [&](int c) {
+      solved[0][c] =
+          mapCandidate(resize(c, anchor, shapes.front()), bits[c], {}, {});
+    });
+    points.push_back(makePoint(partial.front(), bits, solved[0]));
+
+    // Last cost of every candidate, ranking the ones re-mapped
+    std::vector<int> latest(combinations);
+    for (int c = 0; c < combinations; c++) latest[c] = solved[0][c].cost;
+
+    for (size_t s = 1; s < shapes.size(); s++) {
+      const auto &shape = shapes[s];
+      auto resized = operatorGraph->resize(shape);
+      auto nearest = findNearest(shapes, s);
+
+      std::vector<int> ranking(combinations);
+      std::iota(ranking.begin(), ranking.end(), 0);
+      std::stable_sort(ranking.begin(), ranking.end(), [&](int a, int b) {
+        return latest[a] < latest[b];
+      });
+
+      std::vector<std::vector<std::shared_ptr<DNN::OperatorGroup>>>
+          resized_groups(combinations);
+      for (int c = 0; c < combinations; c++)
+        resized_groups[c] = resize(c, resized, shape);
+
+      // Candidates solved at a neighbour seed their own search, the others
+      // are searched cold
+      std::vector<Solution> current(combinations);
+      auto map = [&](const std::vector<int> &mapped) {
+        Runtime::parallelFor(scheduler, mapped.size(), [&](int r) {
+          int c = mapped[r];
+          std::vector<const Solution *> warm;
+          for (auto n : nearest)
+            if (!solved[n][c].mappings.empty()) warm.push_back(&solved[n][c]);
+          current[c] = mapCandidate(resized_groups[c], bits[c], warm, shape);
+        });
+      };
+
+      int num = std::min(candidates, combinations);
+      std::vector<int> top(ranking.begin(), ranking.begin() + num);
+      map(top);
+
+      int best = std::numeric_limits<int>::max();
+      for (int c : top) best = std::min(best, current[c].cost);
+
+      // The warm results may miss a candidate that got cheaper at this
+      // shape; map every other one whose lower bound beats them
+      std::vector<int> rest;
+      for (int r = num; r < combinations; r++) {
+        int c = ranking[r];
+        long long bound = 0;
+        for (const auto &group : resized_groups[c])
+          bound += space->boundGroup(group, mesh);
+        if (bound < best) rest.push_back(c);
+      }
+      map(rest);
+
+      for (int c : top) latest[c] = current[c].cost;
+      for (int c : rest) latest[c] = current[c].cost;
+
+      solved.push_back(current);
+      points.push_back(makePoint(partial[s], bits, current));
+    }
+
+    return points;
+  }
+
+ private:
+  // Best mappings of one fusion candidate at one shape
+  struct Solution {
+    int cost = std::numeric_limits<int>::max();
+    std::vector<Mapping> mappings;
+    long long evaluations = 0;
+  };
+
+  // Map the groups of a candidate, warm-started from solved shapes if any
+  Solution mapCandidate(
+      const std::vector<std::shared_ptr<DNN::OperatorGroup>> &candidate_groups,
+      const std::vector<bool> &fusion_bit,
+      const std::vector<const Solution *> &warm,
+      const DNN::Shape &shape) const {
+    Solution solution;
+    solution.mappings.resize(candidate_groups.size());
+
+    std::vector<int> costs(candidate_groups.size(),
+                           std::numeric_limits<int>::max());
+    std::vector<long long> evaluations(candidate_groups.size());
+    Runtime::parallelFor(scheduler, candidate_groups.size(), [&](int g) {
+      std::vector<Mapping> seeds;
+      for (const auto *neighbour : warm) {
+        if (g >= static_cast<int>(neighbour->mappings.size())) continue;
+        if (neighbour->mappings[g].second.empty()) continue;
+
+        for (bool keep_tiles : {false, true})
+          seeds.push_back(scale(neighbour->mappings[g], shape, keep_tiles));
+      }
+
+      // The best of the ways to materialize the fused tensors
+      for (const auto &variant : space->getGroupVariants(candidate_groups[g])) {
+        auto mapper = space->makeMapper(variant, mesh,
+                                        space->getGroupSeed(fusion_bit, g));
+        if (!seeds.empty())
+          mapper->setWarmStart(seeds, population, generations);
+
+        mapper->search();
+        evaluations[g] += mapper->getStatistics().evaluations;
+        if (mapper->getBestCost() >= costs[g]) continue;
+        costs[g] = mapper->getBestCost();
+        solution.mappings[g] = mapper->getBestMapping();
+      }
+    });
+
+    // Groups run one after another
+    long long total = 0;
+    for (auto cost : costs) total += cost;
+    solution.cost = static_cast<int>(
+        std::min<long long>(total, std::numeric_limits<int>::max()));
+    for (auto e : evaluations) solution.evaluations += e;
+    return solution;
+  }
+
+  // Scale a mapping to a shape. Spatial and sharing factors are kept; the
+  // temporal factor is kept too, growing the tiles with the shape, or
+  // follows the size so tiles keep their footprint
+  static Mapping scale(const Mapping &mapping, const DNN::Shape &shape,
+                       bool keep_tiles) {
+    auto [p, o] = mapping;
+
+    PartitionVector scaled;
+    for (const auto &[dim, factors] : p) {
+      auto [spatial, temporal, sharing] = factors;
+      auto resized = dim.resize(shape);
+
+      double ratio =
+          keep_tiles ? 1.0 * resized.getSize() / std::max(1, dim.getSize())
+                     : 1.0;
+      int limit = std::max(1, resized.getSize() / (spatial * sharing));
+      temporal = std::clamp(static_cast<int>(std::lround(temporal * ratio)), 1,
+                            limit);
+      scaled[resized] = std::make_tuple(spatial, temporal, sharing);
+    }
+
+    for (auto &dim : o) dim = dim.resize(shape);
+    return {scaled, o};
+  }
+
+  // Add the graph's size of every dimension missing from a shape
+  DNN::Shape complete(const DNN::Shape &shape) const {
+    auto full = shape;
+    for (const auto &op : operatorGraph->getOperators())
+      for (const auto &dim : op.getDimensions())
+        full.emplace(dim.getName(), dim.getSize());
+    return full;
+  }
+
+  // Indices of the solved shapes closest to shape s on a log scale
+  std::vector<int> findNearest(const std::vector<DNN::Shape> &shapes,
+                               size_t s) const {
+    auto distance = [&](const DNN::Shape &a, const DNN::Shape &b) {
+      double d = 0.0;
+      for (const auto &[name, size] : a) {
+        auto it = b.find(name);
+        if (it != b.end()) d += std::abs(std::log2(1.0 * size / it->second));
+      }
+      return d;
+    };
+
+    std::vector<int> order(s);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return distance(shapes[s], shapes[a]) < distance(shapes[s], shapes[b]);
+    });
+    order.resize(std::min<size_t>(neighbours, s));
+    return order;
+  }
+
+  // Summarize a shape: the best of its mapped candidates
+  SweepPoint makePoint(const DNN::Shape &shape,
+                       const std::vector<std::vector<bool>> &bits,
+                       const std::vector<Solution> &mapped) const {
+    SweepPoint point;
+    point.shape = shape;
+
+    for (size_t c = 0; c < mapped.size(); c++) {
+      point.evaluations += mapped[c].evaluations;
+      if (mapped[c].mappings.empty()) continue;
+      if (!point.fusion.empty() && mapped[c].cost >= point.cost) continue;
+      point.fusion = bits[c];
+      point.cost = mapped[c].cost;
+      point.mappings = mapped[c].mappings;
+    }
+    return point;
+  }
+
+  // Settings, seeds and fusion candidates of every search
+  std::shared_ptr<const FusionSpace> space;
+
+  // Graph whose dimensions are resized at every shape
+  std::shared_ptr<const DNN::DAG> operatorGraph;
+
+  std::shared_ptr<Architecture::Mesh> mesh;
+
+  // Scheduler of the searches, or nullptr to run sequentially
+  std::shared_ptr<Runtime::Scheduler> scheduler;
+
+  // Top fusion candidates re-mapped at later shapes
+  int candidates = 2;
+
+  // Solved shapes seeding each warm search
+  int neighbours = 2;
+
+  // Budget of the warm-started searches
+  int population = 16;
+  int generations = 4;
+};
+
+#endif
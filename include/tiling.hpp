@@ -23,7 +23,7 @@ class TilingAnalysis {
     }
 
     bool access_tensor = false;
-    auto tensor_dims = tensor.getDimensions();
+    const auto& tensor_dims = tensor.getDimensions();
 
     for (const auto& dim : orderedDimensions) {
       // From inner loop to outer loop
@@ -80,7 +80,7 @@ class TilingAnalysis {
 
     int footprint = tensor_tile_size;
 
-    auto tensor_dims = tensor.getDimensions();
+    const auto& tensor_dims = tensor.getDimensions();
 
     bool expand = false;
     for (auto it = orderedDimensions.rbegin(); it != orderedDimensions.rend();
@@ -133,7 +133,7 @@ class TilingAnalysis {
           continue;
         }
 
-        auto outputs = op.getOutputs();
+        const auto& outputs = op.getOutputs();
         if (std::count(outputs.begin(), outputs.end(), tensor)) {
           // Calculate the footprint of each tensor if it is the output tensor
           footprint += calculateInternalTensorFootprint(tensor, op_dims,
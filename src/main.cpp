@@ -1,9 +1,44 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <sstream>
+
+#include "distributed/coordinator.hpp"
+#include "distributed/service.hpp"
+#include "explore.hpp"
 #include "fusion.hpp"
 #include "partition.hpp"
+#include "sweep.hpp"
 
-int main() {
+int main(int argc, char** argv) {
   // TODO: design a better input format
 
+  // Usage:
+  //   mujica                          search in this process
+  //   mujica --workers N              shard over N local worker processes
+  //   mujica --coordinator SOCKET N   wait for N workers started elsewhere
+  //   mujica --worker SOCKET          serve a coordinator
+  //   mujica --checkpoint PATH        search here, resumable from PATH
+  //   mujica --mcts [BUDGET]          search fusion and mapping jointly
+  //   mujica --pipeline [BATCHES]     pipeline groups over core subsets
+  //   mujica --chips [N] [latency]    place groups on N chips, by default
+  //                                   for throughput over 16 micro-batches
+  //   mujica --sweep [m=512,n=512 ...] map many shapes, warm-started
+  //   mujica --explore [coreNum=16,64 ...] map over a grid of meshes
+  //   mujica --precision TYPE [FUSED] search with TYPE elements, fused
+  //                                   intermediates in FUSED
+  //   mujica --recompute              also try recomputing fused tensors
+  //   mujica --double-buffering       overlap tile transfers with compute
+  //   mujica --surrogate [FRACTION]   evaluate only the top FRACTION of each
+  //                                   generation exactly
+  //   mujica --portfolio [genetic,mcts] race search strategies per group
+  //   mujica --polish [first] [BUDGET] refine mappings by local search
+  //   mujica --canonical [LIMIT]      search canonical loop orders only
+  //   mujica --serve SOCKET [CACHE]   answer queries, caching CACHE entries
+  //   mujica --query SOCKET [REPEATS] ask a service to map this graph
+  //   mujica --shutdown SOCKET        stop a service
+  std::string mode = argc > 1 ? argv[1] : "";
+
   // Define the dimensions
   DNN::Dimension b("b", 1);
   DNN::Dimension h("h", 12);
@@ -16,20 +51,330 @@ int main() {
   DNN::Tensor tQ("tQ", b, h, m, k);
   DNN::Tensor tK("tK", b, h, k, n);
   DNN::Tensor tA("tA", b, h, m, n);
+  DNN::Tensor tS("tS", b, h, m, n);
   DNN::Tensor tV("tV", b, h, n, l);
   DNN::Tensor tO("tO", b, h, m, l);
 
   // Define the operator
   DNN::Operator mm0("MatMul0", {tQ, tK}, {tA});
-  DNN::Operator mm1("MatMul1", {tA, tV}, {tO});
+  DNN::Operator sm("Softmax", DNN::OperatorKind::Softmax, {tA}, {tS});
+  DNN::Operator mm1("MatMul1", {tS, tV}, {tO});
 
   // Define the DAG
-  auto operatorGraph = std::make_shared<DNN::DAG>(mm0, mm1);
+  auto operatorGraph = std::make_shared<DNN::DAG>(mm0, sm, mm1);
 
   // Fusion space
   auto fs = std::make_shared<FusionSpace>(operatorGraph);
 
   auto mesh = std::make_shared<Architecture::Mesh>();
 
-  fs->searchFusionSpace(mesh);
-}
\ No newline at end of file
+  // Worker processes own their scheduler, created after the fork
+  auto serve = [&](std::unique_ptr<Distributed::Channel> channel) {
+    fs->setScheduler(std::make_shared<Runtime::Scheduler>());
+    Distributed::Worker worker(fs, mesh, std::move(channel));
+    worker.run();
+  };
+
+  if (mode == "--worker" && argc > 2) {
+    auto channel = Distributed::Channel::connect(argv[2]);
+    if (!channel) return 1;
+    serve(std::move(channel));
+    return 0;
+  }
+
+  if (mode == "--workers" || mode == "--coordinator") {
+    bool local = mode == "--workers";
+    std::string path = local ? "/tmp/mujica-" + std::to_string(getpid()) +
+                                   ".sock"
+                             : (argc > 2 ? argv[2] : "");
+    int workers = std::atoi(argc > (local ? 2 : 3) ? argv[local ? 2 : 3] : "1");
+
+    Distributed::Coordinator coordinator(path);
+    if (!coordinator.isOpen()) return 1;
+    if (local) workers = coordinator.spawnLocalWorkers(workers, serve);
+
+    int tensor_num = operatorGraph->getNumPotentialFusionTensors();
+    auto best = coordinator.run(tensor_num, workers);
+
+    auto statistics = coordinator.getStatistics();
+    std::cout << "Best cost " << coordinator.getBestCost() << " over "
+              << statistics.candidates << " candidates (" << statistics.pruned
+              << " pruned, " << statistics.cacheHits << " cached groups)\n";
+    return 0;
+  }
+
+  if (mode == "--serve" && argc > 2) {
+    size_t capacity = argc > 3 ? std::atoll(argv[3]) : 4096;
+    Distributed::Service service(argv[2], capacity,
+                                 std::make_shared<Runtime::Scheduler>());
+    if (!service.isOpen()) return 1;
+    service.run();
+
+    auto statistics = service.getStatistics();
+    std::cout << "Answered " << statistics.queries << " queries ("
+              << statistics.cachedQueries << " cached), mapped "
+              << statistics.mappedGroups << " groups ("
+              << statistics.cachedGroups << " cached)\n";
+    return 0;
+  }
+
+  if ((mode == "--query" || mode == "--shutdown") && argc > 2) {
+    auto channel = Distributed::Channel::connect(argv[2]);
+    if (!channel) return 1;
+    if (mode == "--shutdown") return !channel->send(Distributed::SHUTDOWN, {});
+
+    BinaryWriter writer;
+    Distributed::encodeQuery(writer, *operatorGraph, *mesh, 0);
+
+    int repeats = argc > 3 ? std::atoi(argv[3]) : 1;
+    uint32_t type;
+    std::vector<char> payload;
+    for (int i = 0; i < repeats; i++) {
+      auto start = std::chrono::steady_clock::now();
+      if (!channel->send(Distributed::QUERY, writer.getBuffer()) ||
+          !channel->receive(type, payload) || type != Distributed::DECISION)
+        return 1;
+      std::chrono::duration<double, std::micro> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << "Query " << i << ": " << elapsed.count() << " us\n";
+    }
+
+    BinaryReader reader(payload);
+    auto decision = Distributed::decodeDecision(reader);
+    std::cout << "Fusion";
+    for (bool bit : decision.fusion) std::cout << " " << bit;
+    std::cout << ": cost " << decision.cost << "\n";
+    for (const auto& group : decision.groups) {
+      std::cout << "  " << group.signature << ": cost " << group.cost;
+      for (const auto& [name, spatial, temporal, sharing] : group.factors)
+        std::cout << ", " << name << " " << spatial << "/" << temporal << "/"
+                  << sharing;
+      std::cout << "\n";
+    }
+    return 0;
+  }
+
+  // Every level of the search shares one work-stealing scheduler
+  auto scheduler = std::make_shared<Runtime::Scheduler>();
+  fs->setScheduler(scheduler);
+
+  if (mode == "--mcts") {
+    int budget = argc > 2 ? std::atoi(argv[2]) : 20000;
+    auto best = fs->searchJointly(mesh, budget);
+    if (best) best->print();
+    return 0;
+  }
+
+  if (mode == "--pipeline") {
+    int micro_batches = argc > 2 ? std::atoi(argv[2]) : 16;
+    auto best = fs->searchPipeline(mesh, micro_batches);
+    auto report = fs->planPipeline(best, mesh, micro_batches);
+    if (!report.isFeasible()) return 1;
+
+    for (size_t s = 0; s < report.cores.size(); s++)
+      std::cout << "Stage " << s << ": " << report.cores[s] << " cores, "
+                << report.stageCycles[s] << " cycles, "
+                << report.transferCycles[s] << " transfer cycles\n";
+    std::cout << "Interval " << report.interval << ", latency "
+              << report.latency << ", " << micro_batches << " micro-batches in "
+              << report.makespan << " cycles (" << report.getThroughput() * 1e6
+              << " per million cycles)\n";
+    return 0;
+  }
+
+  if (mode == "--chips") {
+    auto system = std::make_shared<Architecture::System>();
+    system->chip = *mesh;
+    system->chipNum = argc > 2 ? std::atoi(argv[2]) : 4;
+    if (system->chipNum < 1) return 1;
+
+    auto objective = argc > 3 && std::string(argv[3]) == "latency"
+                         ? SystemObjective::Latency
+                         : SystemObjective::Throughput;
+    int micro_batches = 16;
+    auto best = fs->searchSystem(system, micro_batches, objective);
+    auto report = fs->planSystem(best, system, micro_batches, objective);
+    if (!report.isFeasible()) return 1;
+
+    for (size_t s = 0; s < report.chips.size(); s++) {
+      int first = report.firstGroups[s];
+      int last = s + 1 < report.chips.size() ? report.firstGroups[s + 1]
+                                             : report.splits.size();
+      std::cout << "Stage " << s << ": groups " << first << "-" << last - 1
+                << " on " << report.chips[s] << " chips";
+      for (int g = first; g < last; g++)
+        if (!report.splits[g].empty())
+          std::cout << ", group " << g << " split along " << report.splits[g];
+      std::cout << ", " << report.stageCycles[s] << " cycles, "
+                << report.transferCycles[s] << " transfer cycles\n";
+    }
+    std::cout << "Interval " << report.interval << ", latency "
+              << report.latency << ", " << micro_batches << " micro-batches in "
+              << report.makespan << " cycles (" << report.getThroughput() * 1e6
+              << " per million cycles)\n";
+    return 0;
+  }
+
+  if (mode == "--sweep") {
+    // Shapes as comma-separated name=size lists, by default a sequence
+    // length sweep
+    std::vector<DNN::Shape> shapes;
+    for (int i = 2; i < argc; i++) {
+      DNN::Shape shape;
+      std::stringstream list(argv[i]);
+      std::string item;
+      while (std::getline(list, item, ',')) {
+        auto eq = item.find('=');
+        if (eq == std::string::npos) continue;
+        shape[item.substr(0, eq)] = std::atoi(item.c_str() + eq + 1);
+      }
+      shapes.push_back(shape);
+    }
+    if (shapes.empty())
+      for (int i = 1; i <= 20; i++)
+        shapes.push_back({{"m", 128 * i}, {"n", 128 * i}});
+
+    ShapeSweep sweep(fs, mesh, scheduler);
+    for (const auto& point : sweep.run(shapes)) {
+      for (const auto& [name, size] : point.shape)
+        std::cout << name << "=" << size << " ";
+      std::cout << "fusion";
+      for (bool bit : point.fusion) std::cout << " " << bit;
+      std::cout << ": cost " << point.cost << ", " << point.evaluations
+                << " evaluations\n";
+    }
+    return 0;
+  }
+
+  if (mode == "--explore") {
+    // Values of each swept mesh parameter as name=value,value,... by
+    // default the core count against the buffer size
+    MeshGrid grid;
+    for (int i = 2; i < argc; i++) {
+      std::string item(argv[i]);
+      auto eq = item.find('=');
+      if (eq == std::string::npos) return 1;
+
+      std::vector<int> values;
+      std::stringstream list(item.substr(eq + 1));
+      std::string value;
+      while (std::getline(list, value, ','))
+        values.push_back(std::atoi(value.c_str()));
+      if (!grid.set(item.substr(0, eq), values)) return 1;
+    }
+    if (argc <= 2) {
+      grid.coreNum = {4, 16, 64};
+      grid.footprintPerCore = {1 << 16, 1 << 18, 1 << 20};
+    }
+
+    ArchitectureSweep sweep(operatorGraph, 0, scheduler);
+    for (const auto& point : sweep.run(grid.expand(*mesh))) {
+      std::cout << (point.pareto ? "* " : "  ") << "coreNum="
+                << point.mesh.coreNum
+                << " footprintPerCore=" << point.mesh.footprintPerCore
+                << " onchipBandwidth=" << point.mesh.onchipBandwidth
+                << " offchipBandwidth=" << point.mesh.offchipBandwidth;
+      if (point.fusion.empty()) {
+        std::cout << ": infeasible\n";
+        continue;
+      }
+      std::cout << " fusion";
+      for (bool bit : point.fusion) std::cout << " " << bit;
+      std::cout << ": cost " << point.cost << "\n";
+    }
+
+    auto statistics = sweep.getStatistics();
+    std::cout << "Mapped " << statistics.mappedGroups << " groups, reused "
+              << statistics.reusedGroups << ", skipped "
+              << statistics.infeasibleGroups << " infeasible\n";
+    return 0;
+  }
+
+  if (mode == "--precision" && argc > 2) {
+    // Elements of every tensor in one type, fused intermediates optionally
+    // in a narrower one
+    auto type = DNN::parseType(argv[2]);
+    auto fused = argc > 3 ? DNN::parseType(argv[3]) : std::nullopt;
+    if (!type || (argc > 3 && !fused)) return 1;
+
+    fs = std::make_shared<FusionSpace>(operatorGraph->cast(*type));
+    fs->setScheduler(scheduler);
+    fs->setFusedPrecision(fused);
+  }
+
+  if (mode == "--recompute") fs->setRecompute(true);
+
+  if (mode == "--double-buffering") fs->setDoubleBuffering(true);
+
+  if (mode == "--surrogate") {
+    double fraction = argc > 2 ? std::atof(argv[2]) : 0.3;
+    if (fraction <= 0 || fraction > 1) return 1;
+    fs->setSurrogateFraction(fraction);
+  }
+
+  if (mode == "--polish") {
+    // Steepest descent unless "first", on the two best individuals of every
+    // generation and on the final result
+    int arg = 2;
+    auto descent = Descent::Steepest;
+    if (argc > arg && std::string(argv[arg]) == "first") {
+      descent = Descent::FirstImprovement;
+      arg++;
+    }
+    long long budget = argc > arg ? std::atoll(argv[arg]) : 1000;
+    if (budget <= 0) return 1;
+
+    fs->setLocalSearch(descent, budget, 2);
+  }
+
+  if (mode == "--canonical") {
+    // Also try every canonical order of the best partition of a group if
+    // it has at most LIMIT
+    long long limit = argc > 2 ? std::atoll(argv[2]) : 1000;
+    if (limit < 0) return 1;
+
+    fs->setCanonicalOrders(true, limit);
+  }
+
+  if (mode == "--portfolio") {
+    // Every registered strategy unless named, e.g. genetic,annealing
+    auto known = StrategyRegistry::getInstance().getNames();
+    auto names = known;
+    if (argc > 2) {
+      names.clear();
+      std::stringstream list(argv[2]);
+      for (std::string name; std::getline(list, name, ',');) {
+        if (!std::count(known.begin(), known.end(), name)) return 1;
+        names.push_back(name);
+      }
+    }
+    fs->setPortfolio(names);
+  }
+
+  if (mode == "--checkpoint" && argc > 2) fs->setCheckpoint(argv[2]);
+
+  auto best = fs->searchFusionSpace(mesh);
+  std::cout << "Best cost " << fs->getBestCost() << " over "
+            << (1 << fs->getOperatorGraph()->getNumPotentialFusionTensors())
+            << " candidates, fusion";
+  for (bool bit : best) std::cout << " " << bit;
+  std::cout << "\n";
+  std::cout << "Pruned " << fs->getPrunedCandidates() << " candidates ("
+            << fs->getPrunedGroups() << " groups unmapped)\n";
+  if (mode == "--surrogate") {
+    auto statistics = fs->getSearchStatistics();
+    std::cout << "Evaluated " << statistics.evaluations << " mappings, "
+              << statistics.surrogateSkipped
+              << " skipped by the surrogate (mean error "
+              << statistics.surrogateError() << ")\n";
+  }
+  if (mode == "--recompute")
+    for (const auto& [signature, fused] : fs->getGroupModes(best))
+      std::cout << "Group " << signature << ": "
+                << (fused == DNN::FusedTensorMode::Recompute ? "recompute"
+                                                              : "store")
+                << "\n";
+  if (mode == "--portfolio")
+    for (const auto& [name, wins] : fs->getStrategyWins())
+      std::cout << "Won by " << name << ": " << wins << " groups\n";
+}
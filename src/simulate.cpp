@@ -0,0 +1,194 @@
+#include <chrono>
+#include <cmath>
+
+#include "algo/random.hpp"
+#include "fusion.hpp"
+#include "sim/simulator.hpp"
+
+// Pearson correlation of two samples
+double pearson(const std::vector<double>& x, const std::vector<double>& y) {
+  int n = static_cast<int>(x.size());
+  if (n < 2) return 0.0;
+
+  double mx = 0, my = 0;
+  for (int i = 0; i < n; i++) mx += x[i] / n, my += y[i] / n;
+
+  double sxy = 0, sxx = 0, syy = 0;
+  for (int i = 0; i < n; i++) {
+    sxy += (x[i] - mx) * (y[i] - my);
+    sxx += (x[i] - mx) * (x[i] - mx);
+    syy += (y[i] - my) * (y[i] - my);
+  }
+  return sxx > 0 && syy > 0 ? sxy / std::sqrt(sxx * syy) : 0.0;
+}
+
+// Ranks of a sample, ties sharing their average rank
+std::vector<double> rank(const std::vector<double>& x) {
+  std::vector<int> idx(x.size());
+  for (int i = 0; i < static_cast<int>(idx.size()); i++) idx[i] = i;
+  std::sort(idx.begin(), idx.end(), [&](int a, int b) { return x[a] < x[b]; });
+
+  std::vector<double> r(x.size());
+  for (int i = 0; i < static_cast<int>(idx.size());) {
+    int j = i;
+    while (j < static_cast<int>(idx.size()) && x[idx[j]] == x[idx[i]]) j++;
+    for (int k = i; k < j; k++) r[idx[k]] = (i + j - 1) / 2.0;
+    i = j;
+  }
+  return r;
+}
+
+// Every term of a kernel on a mapping, so two kernels agree only if each
+// term does
+std::vector<long long> getTerms(Cost::IKernel& kernel,
+                                const Architecture::Mesh& mesh,
+                                const PartitionVector& p,
+                                const std::vector<DNN::Dimension>& o,
+                                bool double_buffering) {
+  kernel.set(p, o);
+  auto [onchip, offchip] = kernel.traffic(mesh);
+  return {kernel.getTileSteps(),   kernel.getSpatialWaves(mesh.coreNum),
+          kernel.compute(mesh),    onchip,
+          offchip,                 kernel.reduction(mesh),
+          kernel.footprint(double_buffering)};
+}
+
+// Seconds a kernel takes to evaluate every mapping `repeats` times
+double timeKernel(Cost::IKernel& kernel, const Architecture::Mesh& mesh,
+                  const std::vector<PartitionVector>& partitions,
+                  const std::vector<std::vector<DNN::Dimension>>& orders,
+                  bool double_buffering, int repeats) {
+  volatile long long sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; r++)
+    for (size_t i = 0; i < partitions.size(); i++)
+      for (auto term : getTerms(kernel, mesh, partitions[i], orders[i],
+                                double_buffering))
+        sink += term;
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+int main(int argc, char** argv) {
+  // Usage: mujica-sim [samples per group] [seed] [double buffering 0/1]
+  int samples = argc > 1 ? std::atoi(argv[1]) : 1000;
+  uint64_t seed = argc > 2 ? std::atoll(argv[2]) : 0;
+  bool double_buffering = argc > 3 && std::atoi(argv[3]);
+
+  // Build the attention matrix multiplications from their einsum specs,
+  // which the operators have to give back unchanged
+  DNN::Shape shape{{"b", 1},    {"h", 12}, {"m", 1024},
+                   {"n", 1024}, {"k", 64}, {"l", 64}};
+  std::string spec0 = "bhmk,bhkn->bhmn";
+  std::string spec1 = "bhmn,bhnl->bhml";
+  auto mm0 =
+      DNN::Operator::einsum("MatMul0", spec0, {"tQ", "tK"}, {"tA"}, shape);
+  auto mm1 =
+      DNN::Operator::einsum("MatMul1", spec1, {"tA", "tV"}, {"tO"}, shape);
+  if (!mm0 || !mm1 || mm0->getSpec() != spec0 || mm1->getSpec() != spec1)
+    return 1;
+
+  auto operatorGraph = std::make_shared<DNN::DAG>(*mm0, *mm1);
+  auto fs = std::make_shared<FusionSpace>(operatorGraph);
+  auto mesh = std::make_shared<Architecture::Mesh>();
+
+  int tensor_num = operatorGraph->getNumPotentialFusionTensors();
+
+  Algorithm::Random rng(seed);
+  long long simulated = 0;
+  double benchmarked = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  // Compare both models on every group of every fusion candidate
+  for (int bits = 0; bits < (1 << tensor_num); bits++) {
+    std::vector<bool> fusion_bit(tensor_num);
+    for (int j = 0; j < tensor_num; j++) fusion_bit[j] = (bits >> j) & 1;
+
+    auto groups = fs->generateOperatorGroups(
+        operatorGraph->findConnectedComponents(fusion_bit));
+
+    for (const auto& group : groups) {
+      auto [operators, tensors, dimensions, internalTensors, externalTensors] =
+          group->getGroupInfo();
+      auto dims =
+          std::vector<DNN::Dimension>(dimensions.begin(), dimensions.end());
+
+      PartitionAnalysis analysis(group, mesh);
+      analysis.setDoubleBuffering(double_buffering);
+
+      Simulation::Config config;
+      config.doubleBuffering = double_buffering;
+      Simulation::MeshSimulator simulator(group, mesh, config);
+
+      std::vector<double> analytical, cycles;
+      double occupancy = 0, dma = 0, link = 0;
+
+      // The specialised kernel against the generic one on every sample
+      auto layout = std::make_shared<const Cost::Layout>(*group);
+      auto specialised = Cost::specialise(layout);
+      Cost::Kernel<0, 0> generic(layout);
+      std::vector<PartitionVector> partitions;
+      std::vector<std::vector<DNN::Dimension>> orders;
+      int agreed = 0;
+
+      for (int i = 0; i < samples; i++) {
+        // Sample the same space the genetic algorithm searches
+        PartitionVector p;
+        for (const auto& dim : dims)
+          p[dim] = {rng.uniformInt(Cost::MAX_FACTOR) + 1,
+                    rng.uniformInt(Cost::MAX_FACTOR) + 1,
+                    rng.uniformInt(Cost::MAX_FACTOR) + 1};
+        auto o = dims;
+        std::shuffle(o.begin(), o.end(), rng);
+
+        partitions.push_back(p);
+        orders.push_back(o);
+        agreed += getTerms(*specialised, *mesh, p, o, double_buffering) ==
+                  getTerms(generic, *mesh, p, o, double_buffering);
+
+        analysis.setPartitionVector(p, o);
+        if (!analysis.constraint()) continue;
+
+        auto report = simulator.run(p, o);
+        analytical.push_back(analysis.evaluate());
+        cycles.push_back(static_cast<double>(report.cycles));
+        occupancy += report.peakBufferOccupancy;
+        dma += report.dmaUtilisation();
+        link += report.linkUtilisation();
+        simulated++;
+      }
+
+      int feasible = static_cast<int>(cycles.size());
+      std::cout << "Fusion " << bits << " group {";
+      for (const auto& op : operators) std::cout << " " << op.getName();
+      std::cout << " }: " << feasible << "/" << samples << " feasible";
+      if (feasible) {
+        std::cout << ", pearson " << pearson(analytical, cycles)
+                  << ", spearman " << pearson(rank(analytical), rank(cycles))
+                  << ", mean occupancy " << occupancy / feasible
+                  << ", dma util " << dma / feasible << ", link util "
+                  << link / feasible;
+      }
+
+      double generic_seconds = timeKernel(generic, *mesh, partitions, orders,
+                                          double_buffering, 10);
+      double specialised_seconds = timeKernel(
+          *specialised, *mesh, partitions, orders, double_buffering, 10);
+      benchmarked += generic_seconds + specialised_seconds;
+      std::cout << "; kernels agree on " << agreed << "/" << samples;
+      if (specialised_seconds > 0)
+        std::cout << ", specialised " << generic_seconds / specialised_seconds
+                  << "x the generic speed";
+      std::cout << "\n";
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count() -
+                   benchmarked;
+  std::cout << "Simulated " << simulated << " mappings in " << seconds
+            << " s (" << (seconds > 0 ? simulated / seconds * 60 : 0)
+            << " mappings/min)\n";
+}